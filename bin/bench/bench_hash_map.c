@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "src/data_structures/hash_map.h"
+#include "src/io/memory.h"
+#include "src/error/error.h"
+
+// Inserts and looks up n string keys for growing n. Flat nanoseconds per operation
+// as n grows past the caches show the lookups stay O(1).
+#define BENCH_KEY_SIZE 16
+
+static uint64_t bench_random(uint64_t *r_state) {
+    *r_state ^= *r_state << 13;
+    *r_state ^= *r_state >> 7;
+    *r_state ^= *r_state << 17;
+    return *r_state;
+}
+
+static double bench_ns_per_op(Uint64 p_start, size_t p_count) {
+    return (double)(SDL_GetPerformanceCounter() - p_start) * 1e9 / (double)SDL_GetPerformanceFrequency() / (double)p_count;
+}
+
+static void bench_run(size_t p_count, uint64_t *r_random) {
+    char *keys = mmalloc(BENCH_KEY_SIZE * p_count);
+    uint32_t *order = mmalloc(sizeof(uint32_t) * p_count);
+    for (uint32_t i = 0; i < p_count; i++) {
+        snprintf(&keys[i * BENCH_KEY_SIZE], BENCH_KEY_SIZE, "key%u", i);
+        order[i] = i;
+    }
+
+    // Looked up in random order so the probes do not follow the insertion order through memory
+    for (size_t i = p_count - 1; i > 0; i--) {
+        const size_t j = bench_random(r_random) % (i + 1);
+        const uint32_t swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+
+    HashMap *map = hashmap_create(sizeof(uint32_t));
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (uint32_t i = 0; i < p_count; i++) {
+        const char *key = &keys[i * BENCH_KEY_SIZE];
+        hashmap_insert(map, key, strlen(key) + 1, &i);
+    }
+    const double insert_ns = bench_ns_per_op(start, p_count);
+
+    start = SDL_GetPerformanceCounter();
+    for (size_t i = 0; i < p_count; i++) {
+        const char *key = &keys[order[i] * BENCH_KEY_SIZE];
+        const uint32_t *value = hashmap_get(map, key, strlen(key) + 1);
+        CRASH_COND_MSG(!value || *value != order[i], "FATAL: Wrong value for '%s'", key);
+    }
+    const double hit_ns = bench_ns_per_op(start, p_count);
+
+    // Same length keys that were never inserted
+    start = SDL_GetPerformanceCounter();
+    for (size_t i = 0; i < p_count; i++) {
+        char key[BENCH_KEY_SIZE];
+        snprintf(key, BENCH_KEY_SIZE, "kez%u", order[i]);
+        CRASH_COND_MSG(hashmap_get(map, key, strlen(key) + 1) != NULL, "FATAL: Found missing key '%s'", key);
+    }
+    const double miss_ns = bench_ns_per_op(start, p_count);
+
+    printf("%10zu %12.1f %12.1f %12.1f %12zu\n", p_count, insert_ns, hit_ns, miss_ns, hashmap_capacity(map));
+
+    hashmap_free(map);
+    mfree(order);
+    mfree(keys);
+}
+
+int main(int argc, char *argv[]) {
+    // Up to 2M keys by default, pass a larger count to go further
+    size_t max_count = 1 << 21;
+    if (argc > 1) {
+        max_count = strtoull(argv[1], NULL, 10);
+    }
+
+    uint64_t random = 0x9e3779b97f4a7c15ull;
+    printf("%10s %12s %12s %12s %12s\n", "keys", "insert ns", "hit ns", "miss ns", "capacity");
+    for (size_t count = 1024; count <= max_count; count *= 2) {
+        bench_run(count, &random);
+    }
+    return 0;
+}
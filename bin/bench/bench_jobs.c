@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+
+#include "src/jobs/jobs.h"
+#include "src/io/memory.h"
+
+// Runs the same CPU bound parallel_for with the job system started on 1 thread up to one per core
+// and prints the speedup over 1 thread. Each item costs about as much as transforming and culling
+// an object. parallel_for makes at most 4 batches per thread, so a min batch of 1 always gets that
+// many, while the coarse min batch caps the run at 8 batches and stops scaling past 2 threads.
+#define BENCH_ITEMS (1 << 18)
+#define BENCH_ITEM_ROUNDS 16
+#define BENCH_REPEATS 10
+#define BENCH_FINE_BATCH 1
+#define BENCH_COARSE_BATCH (BENCH_ITEMS / 8)
+
+typedef struct BenchData {
+    const float *input;
+    float *output;
+} BenchData;
+
+static void bench_items(void *p_data, size_t p_begin, size_t p_end) {
+    BenchData *data = p_data;
+    for (size_t i = p_begin; i < p_end; i++) {
+        float x = data->input[i];
+        for (int round = 0; round < BENCH_ITEM_ROUNDS; round++) {
+            x = x * 0.999f + 0.5f / (1.0f + x * x);
+        }
+        data->output[i] = x;
+    }
+}
+
+// Same split as parallel_for, printed so each column shows whether the min batch bound.
+static size_t bench_batch_count(size_t p_min_batch, int p_thread_count) {
+    return SDL_min((BENCH_ITEMS + p_min_batch - 1) / p_min_batch, (size_t)p_thread_count * 4);
+}
+
+// Best of BENCH_REPEATS in milliseconds, so a preempted run does not count.
+static double bench_run(BenchData *p_data, size_t p_min_batch) {
+    double best = 0.0;
+    for (int repeat = 0; repeat < BENCH_REPEATS; repeat++) {
+        const Uint64 start = SDL_GetPerformanceCounter();
+        parallel_for(BENCH_ITEMS, p_min_batch, bench_items, p_data);
+        const double ms = (double)(SDL_GetPerformanceCounter() - start) * 1e3 / (double)SDL_GetPerformanceFrequency();
+        best = repeat == 0 ? ms : SDL_min(best, ms);
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    // Up to one thread per core by default
+    int max_threads = SDL_GetCPUCount();
+    if (argc > 1) {
+        max_threads = atoi(argv[1]);
+    }
+    max_threads = SDL_max(SDL_min(max_threads, JOB_MAX_WORKERS + 1), 1);
+
+    float *input = mmalloc(sizeof(float) * BENCH_ITEMS);
+    float *output = mmalloc(sizeof(float) * BENCH_ITEMS);
+    for (size_t i = 0; i < BENCH_ITEMS; i++) {
+        input[i] = (float)(i % 1000) / 100.0f;
+    }
+    BenchData data = { .input = input, .output = output };
+
+    printf("%d items of %d rounds, best of %d runs\n", BENCH_ITEMS, BENCH_ITEM_ROUNDS, BENCH_REPEATS);
+    printf("min batch %d and %d\n", BENCH_FINE_BATCH, BENCH_COARSE_BATCH);
+    printf("%8s %8s %10s %8s %8s %10s %8s\n", "threads", "batches", "fine ms", "speedup", "batches", "coarse ms", "speedup");
+    double fine_base = 0.0;
+    double coarse_base = 0.0;
+    for (int thread_count = 1; thread_count <= max_threads; thread_count++) {
+        job_system_init(thread_count - 1);
+        const double fine_ms = bench_run(&data, BENCH_FINE_BATCH);
+        const double coarse_ms = bench_run(&data, BENCH_COARSE_BATCH);
+        job_system_shutdown();
+
+        if (thread_count == 1) {
+            fine_base = fine_ms;
+            coarse_base = coarse_ms;
+        }
+        printf("%8d %8zu %10.2f %8.2f %8zu %10.2f %8.2f\n", thread_count,
+            bench_batch_count(BENCH_FINE_BATCH, thread_count), fine_ms, fine_base / fine_ms,
+            bench_batch_count(BENCH_COARSE_BATCH, thread_count), coarse_ms, coarse_base / coarse_ms);
+    }
+
+    mfree(output);
+    mfree(input);
+    return 0;
+}
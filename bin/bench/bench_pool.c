@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+
+#include "src/io/memory.h"
+#include "src/error/error.h"
+
+// Each thread keeps BENCH_LIVE_BLOCKS small blocks alive and replaces a random one per step,
+// so the allocators see the interleaved frees and allocations of long running object churn.
+#define BENCH_LIVE_BLOCKS 4096
+#define BENCH_STEPS 2000000
+#define BENCH_MIN_SIZE 16
+#define BENCH_MAX_SIZE 256
+#define BENCH_MAX_THREADS 64
+
+typedef void *(*BenchAlloc)(size_t p_size);
+typedef void (*BenchFree)(void *p_ptr, size_t p_size);
+
+typedef struct BenchAllocator {
+    BenchAlloc alloc;
+    BenchFree free;
+    void (*flush)(void); // Before the thread exits, NULL when there is nothing to hand back
+} BenchAllocator;
+
+typedef struct BenchThread {
+    const BenchAllocator *allocator;
+    uint64_t random;
+} BenchThread;
+
+static void *bench_malloc(size_t p_size) {
+    return malloc(p_size);
+}
+
+static void bench_free(void *p_ptr, size_t p_size) {
+    (void)p_size;
+    free(p_ptr);
+}
+
+static uint64_t bench_random(uint64_t *r_state) {
+    *r_state ^= *r_state << 13;
+    *r_state ^= *r_state >> 7;
+    *r_state ^= *r_state << 17;
+    return *r_state;
+}
+
+static int bench_churn(void *p_thread) {
+    BenchThread *thread = p_thread;
+    const BenchAllocator *allocator = thread->allocator;
+    void **blocks = calloc(BENCH_LIVE_BLOCKS, sizeof(void *));
+    uint16_t *sizes = calloc(BENCH_LIVE_BLOCKS, sizeof(uint16_t));
+
+    for (size_t i = 0; i < BENCH_STEPS; i++) {
+        const uint64_t random = bench_random(&thread->random);
+        const size_t slot = random % BENCH_LIVE_BLOCKS;
+        allocator->free(blocks[slot], sizes[slot]);
+
+        // Written so the block is really touched, as an object would be
+        sizes[slot] = BENCH_MIN_SIZE + (random >> 32) % (BENCH_MAX_SIZE - BENCH_MIN_SIZE + 1);
+        blocks[slot] = allocator->alloc(sizes[slot]);
+        *(uint64_t *)blocks[slot] = random;
+    }
+
+    for (size_t i = 0; i < BENCH_LIVE_BLOCKS; i++) {
+        allocator->free(blocks[i], sizes[i]);
+    }
+    free(sizes);
+    free(blocks);
+    if (allocator->flush) {
+        allocator->flush();
+    }
+    return 0;
+}
+
+// Million alloc and free pairs per second across all threads.
+static double bench_run(const BenchAllocator *p_allocator, int p_thread_count) {
+    BenchThread threads[BENCH_MAX_THREADS];
+    SDL_Thread *handles[BENCH_MAX_THREADS];
+    const Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < p_thread_count; i++) {
+        threads[i] = (BenchThread){ .allocator = p_allocator, .random = 0x9e3779b97f4a7c15ull * (i + 1) };
+        handles[i] = SDL_CreateThread(bench_churn, "bench", &threads[i]);
+        CRASH_NULL_MSG(handles[i], "%s", "FATAL: Could not start a benchmark thread!");
+    }
+    for (int i = 0; i < p_thread_count; i++) {
+        SDL_WaitThread(handles[i], NULL);
+    }
+    const double seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+    return (double)BENCH_STEPS * p_thread_count / seconds / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+    // Up to one thread per core by default
+    int max_threads = SDL_GetCPUCount();
+    if (argc > 1) {
+        max_threads = atoi(argv[1]);
+    }
+    max_threads = SDL_max(SDL_min(max_threads, BENCH_MAX_THREADS), 1);
+
+    const BenchAllocator pool = { pool_alloc, pool_free, pool_thread_flush };
+    const BenchAllocator libc = { bench_malloc, bench_free, NULL };
+
+    printf("%d steps per thread, %d live blocks of %d to %d bytes\n", BENCH_STEPS, BENCH_LIVE_BLOCKS, BENCH_MIN_SIZE, BENCH_MAX_SIZE);
+    printf("%8s %16s %16s\n", "threads", "pool Mops/s", "malloc Mops/s");
+    for (int thread_count = 1;; thread_count = SDL_min(thread_count * 2, max_threads)) {
+        printf("%8d %16.1f %16.1f\n", thread_count, bench_run(&pool, thread_count), bench_run(&libc, thread_count));
+        if (thread_count == max_threads) {
+            break;
+        }
+    }
+    return 0;
+}
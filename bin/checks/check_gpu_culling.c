@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <vulkan/vulkan.h>
+
+#include "src/io/io.h"
+#include "src/engine.h"
+#include "src/object.h"
+#include "src/data_structures/vector.h"
+#include "src/error/error.h"
+
+// Draws single frames of a scene whose visible set is known and reads back what the culling produced.
+// Half the objects sit in front of the camera, half behind it, all far from the frustum planes so the
+// CPU box test and the GPU sphere test must agree. Exits with 1 on any mismatch.
+// Run it on lavapipe, e.g. VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json xvfb-run bin/check_gpu_culling
+#define CHECK_GRID 4
+#define CHECK_ROOMS 3
+#define CHECK_VISIBLE (CHECK_GRID * CHECK_GRID + CHECK_ROOMS)
+
+typedef struct CheckResult {
+    DrawStats stats;
+    uint32_t instances; // Sum of the instance counts the cull pass wrote
+    uint32_t meshlet_objects; // Objects handed to the meshlet pass
+    uint32_t misplaced; // Compacted instances of objects behind the camera
+} CheckResult;
+
+static Mesh *check_cube_create(Engine *p_engine) {
+    VertexVector vertexes = { 0 };
+    U32Vector indices = { 0 };
+    for (int i = 0; i < 8; i++) {
+        vertex_vector_push_back(&vertexes, (Vertex){
+            .pos = (Vect3){ .x = (i & 1) - 0.5f, .y = ((i >> 1) & 1) - 0.5f, .z = ((i >> 2) & 1) - 0.5f },
+            .color = (Vect4){ .x = 1.0f, .y = 1.0f, .z = 1.0f, .w = 1.0f },
+        });
+    }
+
+    const uint32_t faces[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+    for (int i = 0; i < 6; i++) {
+        const uint32_t quad[6] = { faces[i][0], faces[i][1], faces[i][2], faces[i][0], faces[i][2], faces[i][3] };
+        u32_vector_append_range(&indices, quad, 6);
+    }
+
+    Mesh *mesh = mesh_create(&p_engine->renderer, &p_engine->window, &vertexes, &indices);
+    vertex_vector_free(&vertexes);
+    u32_vector_free(&indices);
+    return mesh;
+}
+
+// The camera sits at the origin looking down -z, objects in front of it have a negative z.
+static void check_scene_create(Engine *p_engine) {
+    char model_path[512];
+    get_resource_path(model_path, "resources/viking_room.obj");
+    VertexVector vertexes;
+    U32Vector indices;
+    load_obj(model_path, &vertexes, &indices);
+
+    vk_renderer_upload_begin(&p_engine->renderer);
+    Mesh *room = mesh_create(&p_engine->renderer, &p_engine->window, &vertexes, &indices);
+    vertex_vector_free(&vertexes);
+    u32_vector_free(&indices);
+    Mesh *cube = check_cube_create(p_engine);
+
+    char image_path[512];
+    get_resource_path(image_path, "resources/viking_room.png");
+    Texture *texture = texture_create(&p_engine->renderer, &p_engine->window, image_path);
+
+    for (int side = -1; side <= 1; side += 2) {
+        for (int i = 0; i < CHECK_GRID; i++) {
+            for (int j = 0; j < CHECK_GRID; j++) {
+                Object object = { .position = (Vect3){ 2 * i - CHECK_GRID, 2 * j - CHECK_GRID, side * 20 } };
+                surface_init(&object.surface, cube, texture);
+                engine_add_object(p_engine, &object);
+            }
+        }
+        for (int i = 0; i < CHECK_ROOMS; i++) {
+            Object object = { .position = (Vect3){ 4 * i - 4, 0, side * 30 } };
+            surface_init(&object.surface, room, texture);
+            engine_add_object(p_engine, &object);
+        }
+    }
+    mesh_unref(&p_engine->renderer, room);
+    mesh_unref(&p_engine->renderer, cube);
+    texture_unref(&p_engine->renderer, texture);
+    vk_renderer_upload_submit(&p_engine->renderer, &p_engine->window);
+}
+
+static CheckResult check_frame(Engine *p_engine, bool p_gpu_culling, bool p_meshlet_culling) {
+    VkRenderer *renderer = &p_engine->renderer;
+    renderer->gpu_culling = p_gpu_culling;
+    renderer->meshlet_culling = p_meshlet_culling;
+
+    const size_t frame = renderer->current_frame;
+    arena_reset(&p_engine->frame_arena);
+    vk_draw_frame(renderer, &p_engine->window, &p_engine->camera, &p_engine->objects, &p_engine->frame_arena);
+    CRASH_COND_MSG(vkDeviceWaitIdle(p_engine->window.vk_device) != VK_SUCCESS, "%s", "FATAL: Failed to wait for the device!");
+
+    CheckResult result = { .stats = renderer->draw_stats };
+    if (!p_gpu_culling) {
+        return result;
+    }
+
+    // Host coherent, readable once the device is idle
+    const FrameData *frame_data = &renderer->frame_data[frame];
+    const VkDrawIndexedIndirectCommand *draws = frame_data->draw_memory.mapped;
+    const InstanceData *instances = frame_data->instance_memory.mapped;
+    for (uint32_t run = 0; run < result.stats.runs; run++) {
+        result.instances += draws[run].instanceCount;
+        for (uint32_t i = 0; i < draws[run].instanceCount; i++) {
+            result.misplaced += instances[draws[run].firstInstance + i].model[3][2] >= 0.0f;
+        }
+    }
+    if (p_meshlet_culling) {
+        result.meshlet_objects = ((const MeshletTasks *)frame_data->meshlet_task_memory.mapped)->dispatch.x;
+    }
+    return result;
+}
+
+static bool check(bool p_passed, const char *p_name, uint32_t p_value, uint32_t p_expected) {
+    printf("%s %s: %u, expected %u\n", p_passed ? "PASS" : "FAIL", p_name, p_value, p_expected);
+    return p_passed;
+}
+
+int main(void) {
+    Engine *engine = engine_create(1280, 800);
+
+    // Names the device in the log, so a run meant for lavapipe shows it landed on llvmpipe
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(engine->window.vk_physical_device, &device_properties);
+    printf("Device: %s%s\n", device_properties.deviceName, device_properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU ? " (CPU)" : "");
+
+    engine->camera.position = (Vect3){ 0, 0, 0 };
+    engine->camera.rotation = (Vect3){ 0, 0, 1 };
+    check_scene_create(engine);
+
+    bool passed = true;
+    const CheckResult cpu = check_frame(engine, false, false);
+    passed &= check(cpu.stats.instances == CHECK_VISIBLE, "CPU culled instances", cpu.stats.instances, CHECK_VISIBLE);
+
+    if (!engine->renderer.gpu_culling_supported) {
+        printf("FAIL GPU culling is not supported, the device lacks drawIndirectFirstInstance\n");
+        passed = false;
+    } else {
+        const CheckResult gpu = check_frame(engine, true, false);
+        passed &= check(gpu.instances == CHECK_VISIBLE, "GPU culled instances", gpu.instances, CHECK_VISIBLE);
+        passed &= check(gpu.misplaced == 0, "GPU instances behind the camera", gpu.misplaced, 0);
+    }
+
+    // Levels with meshlets skip the instance counts, their objects go through the meshlet pass instead
+    if (engine->renderer.meshlet_culling_supported) {
+        const CheckResult meshlet = check_frame(engine, true, true);
+        passed &= check(meshlet.instances + meshlet.meshlet_objects == CHECK_VISIBLE, "GPU culled instances and meshlet objects",
+            meshlet.instances + meshlet.meshlet_objects, CHECK_VISIBLE);
+        passed &= check(meshlet.misplaced == 0, "GPU instances behind the camera with meshlets", meshlet.misplaced, 0);
+    } else {
+        printf("SKIP meshlet culling is not supported\n");
+    }
+
+    engine_cleanup(engine);
+    return passed ? 0 : 1;
+}
@@ -15,23 +15,36 @@ int main(void) {
     char model_path[512];
     get_resource_path(model_path, "resources/viking_room.obj");
 
-    Vector vertexes;
-    Vector indices;
+    VertexVector vertexes;
+    U32Vector indices;
     load_obj(model_path, &vertexes, &indices);
 
+    // Record every upload into one submit.
+    vk_renderer_upload_begin(&engine->renderer);
+
+    // Uploaded once, the CPU copy is no longer needed after.
+    Mesh *mesh = mesh_create(&engine->renderer, &engine->window, &vertexes, &indices);
+    vertex_vector_free(&vertexes);
+    u32_vector_free(&indices);
+
     char image_path[512];
     get_resource_path(image_path, "resources/viking_room.png");
     Texture *texture = texture_create(&engine->renderer, &engine->window, image_path);
 
     for (int i = 0; i < 15; i++) {
         for (int j = 0; j < 15; j++) {
-            engine_add_object(engine, &(Object) {
+            Object object = {
                 .position = (Vect3){(3 * i), (3 * j), 0},
                 .rotation = (Vect3){-90, 0, 0},
-                .surface = *surface_create(&engine->renderer, &engine->window, vertexes, indices, texture),
-            });
+            };
+            surface_init(&object.surface, mesh, texture);
+            engine_add_object(engine, &object);
         }
     }
+    mesh_unref(&engine->renderer, mesh);
+    texture_unref(&engine->renderer, texture);
+
+    vk_renderer_upload_submit(&engine->renderer, &engine->window);
 
     engine_run(engine);
     engine_cleanup(engine);
@@ -1,22 +1,26 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec4 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
 layout(location = 2) in vec3 fragWorldPos;
 layout(location = 3) in vec3 fragNormal;
 layout(location = 4) in vec3 fragCamPos;
+layout(location = 5) flat in uint fragTexture;
 
 layout(location = 0) out vec4 outColor;
 
-layout(binding = 1) uniform sampler2D texSampler;
+// Every texture, the index differs between instances of one draw
+layout(set = 1, binding = 0) uniform sampler2D textures[];
 
 layout(push_constant) uniform PushBlock {
 	bool lighting_enabled;
 } pushBlock;
 
 void main() {
+	vec4 texColor = texture(textures[nonuniformEXT(fragTexture)], fragTexCoord);
 	if (pushBlock.lighting_enabled == false) {
-		outColor = texture(texSampler, fragTexCoord);
+		outColor = texColor;
 		return;
 	}
 	vec3 lightPos = vec3(0, 50, 0);
@@ -38,7 +42,7 @@ void main() {
 	vec3 specular = specularStrength * spec * lightColor;
 
 
-	vec4 result = vec4(ambient + diffuse + specular, 1.0) * texture(texSampler, fragTexCoord);
+	vec4 result = vec4(ambient + diffuse + specular, 1.0) * texColor;
 	outColor = vec4(result);
 
 	//outColor = fragColor;
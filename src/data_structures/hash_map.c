@@ -1,62 +1,274 @@
 #include "hash_map.h"
 
+#include <stdint.h>
+#include <string.h>
+
 #include "src/io/memory.h"
 #include "src/error/error.h"
-#include "vector.h"
 
-typedef struct MapEntry {
-    char *key;
-    void *data;
-} MapEntry;
+#define HASHMAP_MIN_CAPACITY 16
+
+// Slots are laid out as [MapSlot][value], keys live in one shared pool.
+// distance is the probe length + 1, with 0 marking an empty slot.
+typedef struct MapSlot {
+    uint32_t hash;
+    uint32_t distance;
+    size_t key_offset;
+    size_t key_length;
+} MapSlot;
 
 struct HashMap {
-    size_t key_size;
     size_t value_size;
-    Vector map;
+    size_t slot_size;
+
+    size_t size;
+    size_t capacity;
+    char *slots;
+
+    // Key storage, removed keys are reclaimed on the next rehash.
+    size_t keys_live;
+    size_t keys_size;
+    size_t keys_capacity;
+    char *keys;
+
+    // Scratch slot used while displacing entries.
+    char *swap;
 };
 
+static uint32_t hashmap_hash(const char *p_key, size_t p_key_length) {
+    // FNV-1a followed by a murmur3 finaliser to spread low entropy keys.
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < p_key_length; i++) {
+        hash ^= (uint8_t)p_key[i];
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return (uint32_t)hash;
+}
+
+static inline MapSlot *hashmap_slot(const HashMap *p_hashmap, size_t p_idx) {
+    return (MapSlot *)(void *)(p_hashmap->slots + (p_idx * p_hashmap->slot_size));
+}
+
+static inline void *hashmap_slot_value(MapSlot *p_slot) {
+    return (char *)p_slot + sizeof(MapSlot);
+}
+
+static size_t hashmap_key_store(HashMap *r_hashmap, const char *p_key, size_t p_key_length) {
+    if (r_hashmap->keys_size + p_key_length > r_hashmap->keys_capacity) {
+        size_t new_capacity = r_hashmap->keys_capacity == 0 ? 256 : r_hashmap->keys_capacity * 2;
+        while (new_capacity < r_hashmap->keys_size + p_key_length) {
+            new_capacity *= 2;
+        }
+        r_hashmap->keys = mrealloc(r_hashmap->keys, new_capacity);
+        r_hashmap->keys_capacity = new_capacity;
+    }
+
+    size_t offset = r_hashmap->keys_size;
+    memcpy(r_hashmap->keys + offset, p_key, p_key_length);
+    r_hashmap->keys_size += p_key_length;
+    return offset;
+}
+
+// Robin Hood placement of a slot that is known not to be in the map.
+static void hashmap_place(HashMap *r_hashmap, MapSlot *p_slot) {
+    const size_t mask = r_hashmap->capacity - 1;
+    size_t idx = p_slot->hash & mask;
+    p_slot->distance = 1;
+
+    MapSlot *carried = p_slot;
+    MapSlot *swap = (MapSlot *)(void *)r_hashmap->swap;
+    while (true) {
+        MapSlot *slot = hashmap_slot(r_hashmap, idx);
+        if (slot->distance == 0) {
+            memcpy(slot, carried, r_hashmap->slot_size);
+            return;
+        }
+
+        if (slot->distance < carried->distance) {
+            memcpy(swap, slot, r_hashmap->slot_size);
+            memcpy(slot, carried, r_hashmap->slot_size);
+            memcpy(carried, swap, r_hashmap->slot_size);
+        }
+
+        carried->distance++;
+        idx = (idx + 1) & mask;
+    }
+}
+
+static void hashmap_rehash(HashMap *r_hashmap, size_t p_capacity) {
+    char *old_slots = r_hashmap->slots;
+    char *old_keys = r_hashmap->keys;
+    const size_t old_capacity = r_hashmap->capacity;
+    const size_t old_keys_size = r_hashmap->keys_size;
+
+    r_hashmap->capacity = p_capacity;
+    r_hashmap->slots = mmalloc(r_hashmap->slot_size * p_capacity);
+    memset(r_hashmap->slots, 0, r_hashmap->slot_size * p_capacity);
+
+    // Compact live keys into a fresh pool.
+    r_hashmap->keys = NULL;
+    r_hashmap->keys_size = 0;
+    r_hashmap->keys_capacity = 0;
+    if (old_keys_size > 0) {
+        r_hashmap->keys_capacity = old_keys_size;
+        r_hashmap->keys = mmalloc(old_keys_size);
+    }
+
+    MapSlot *carried = (MapSlot *)(void *)(r_hashmap->swap + r_hashmap->slot_size);
+    for (size_t i = 0; i < old_capacity; i++) {
+        const MapSlot *slot = (const MapSlot *)(const void *)(old_slots + (i * r_hashmap->slot_size));
+        if (slot->distance == 0) {
+            continue;
+        }
+        memcpy(carried, slot, r_hashmap->slot_size);
+        carried->key_offset = hashmap_key_store(r_hashmap, old_keys + slot->key_offset, slot->key_length);
+        hashmap_place(r_hashmap, carried);
+    }
+
+    mfree(old_slots);
+    mfree(old_keys);
+}
+
+static MapSlot *hashmap_find(const HashMap *p_hashmap, const char *p_key, size_t p_key_length, uint32_t p_hash, size_t *r_idx) {
+    if (p_hashmap->capacity == 0) {
+        return NULL;
+    }
+
+    const size_t mask = p_hashmap->capacity - 1;
+    size_t idx = p_hash & mask;
+    uint32_t distance = 1;
+    while (true) {
+        MapSlot *slot = hashmap_slot(p_hashmap, idx);
+        if (slot->distance < distance) {
+            return NULL;
+        }
+
+        if (slot->hash == p_hash && slot->key_length == p_key_length && memcmp(p_hashmap->keys + slot->key_offset, p_key, p_key_length) == 0) {
+            if (r_idx) {
+                *r_idx = idx;
+            }
+            return slot;
+        }
+
+        distance++;
+        idx = (idx + 1) & mask;
+    }
+}
+
 HashMap *hashmap_create(size_t value_size) {
     HashMap *map = mmalloc(sizeof(HashMap));
     map->value_size = value_size;
-    map->map = (Vector){ 0, 0, sizeof(MapEntry), NULL };
+    map->slot_size = (sizeof(MapSlot) + value_size + (sizeof(size_t) - 1)) & ~(sizeof(size_t) - 1);
+    map->size = 0;
+    map->capacity = 0;
+    map->slots = NULL;
+    map->keys_live = 0;
+    map->keys_size = 0;
+    map->keys_capacity = 0;
+    map->keys = NULL;
+    map->swap = mmalloc(map->slot_size * 2);
     return map;
 }
 
 void hashmap_free(HashMap *r_hashmap) {
-    for (size_t i = 0; i < r_hashmap->map.size; i++) {
-        const MapEntry *entry = r_hashmap->map.data + (i * r_hashmap->map.data_size);
-        mfree(entry->key);
-        mfree(entry->data);
+    mfree(r_hashmap->slots);
+    mfree(r_hashmap->keys);
+    mfree(r_hashmap->swap);
+    mfree(r_hashmap);
+}
+
+void hashmap_reserve(HashMap *r_hashmap, size_t p_count) {
+    // Keep the load factor under 7/8.
+    size_t capacity = HASHMAP_MIN_CAPACITY;
+    while (capacity - (capacity / 8) < p_count) {
+        capacity *= 2;
+    }
+
+    if (capacity > r_hashmap->capacity) {
+        hashmap_rehash(r_hashmap, capacity);
     }
 }
 
+size_t hashmap_size(const HashMap *p_hashmap) {
+    return p_hashmap->size;
+}
+
+size_t hashmap_capacity(const HashMap *p_hashmap) {
+    return p_hashmap->capacity;
+}
+
 void hashmap_insert(HashMap *r_hashmap, const char *p_key, size_t p_key_size, const void *p_data) {
-    for (size_t i = 0; i < r_hashmap->map.size; i++) {
-        const MapEntry *entry = r_hashmap->map.data + (i * r_hashmap->map.data_size);
-        if (strncmp(p_key, entry->key, p_key_size) == 0) {
-            memcpy(entry->data, p_data, r_hashmap->value_size);
-            return;
-        }
+    const size_t key_length = strnlen(p_key, p_key_size);
+    const uint32_t hash = hashmap_hash(p_key, key_length);
+
+    MapSlot *existing = hashmap_find(r_hashmap, p_key, key_length, hash, NULL);
+    if (existing) {
+        memcpy(hashmap_slot_value(existing), p_data, r_hashmap->value_size);
+        return;
     }
 
-    // Ugly but will do...
-    MapEntry *new_entry = mmalloc(sizeof(MapEntry));
-    new_entry->key = mmalloc(p_key_size);
-    new_entry->data = mmalloc(r_hashmap->value_size);
+    // Compact instead of growing the key pool when most of it is removed keys.
+    if (r_hashmap->keys_size + key_length > r_hashmap->keys_capacity && r_hashmap->keys_live * 2 < r_hashmap->keys_size) {
+        hashmap_rehash(r_hashmap, r_hashmap->capacity);
+    }
+    hashmap_reserve(r_hashmap, r_hashmap->size + 1);
 
-    memcpy(new_entry->key, p_key, p_key_size);
-    memcpy(new_entry->data, p_data, r_hashmap->value_size);
-    vector_push_back(&r_hashmap->map, new_entry);
+    MapSlot *carried = (MapSlot *)(void *)(r_hashmap->swap + r_hashmap->slot_size);
+    carried->hash = hash;
+    carried->key_offset = hashmap_key_store(r_hashmap, p_key, key_length);
+    carried->key_length = key_length;
+    memcpy(hashmap_slot_value(carried), p_data, r_hashmap->value_size);
 
-    mfree(new_entry);
+    hashmap_place(r_hashmap, carried);
+    r_hashmap->keys_live += key_length;
+    r_hashmap->size++;
 }
 
 void *hashmap_get(HashMap *r_hashmap, const char *p_key, size_t p_key_size) {
-    for (size_t i = 0; i < r_hashmap->map.size; i++) {
-        const MapEntry *entry = r_hashmap->map.data + (i * r_hashmap->map.data_size);
-        if (strncmp(p_key, entry->key, p_key_size) == 0) {
-            return entry->data;
-        }
+    const size_t key_length = strnlen(p_key, p_key_size);
+    MapSlot *slot = hashmap_find(r_hashmap, p_key, key_length, hashmap_hash(p_key, key_length), NULL);
+    if (!slot) {
+        return NULL;
+    }
+    return hashmap_slot_value(slot);
+}
+
+bool hashmap_remove(HashMap *r_hashmap, const char *p_key, size_t p_key_size) {
+    const size_t key_length = strnlen(p_key, p_key_size);
+
+    size_t idx = 0;
+    MapSlot *slot = hashmap_find(r_hashmap, p_key, key_length, hashmap_hash(p_key, key_length), &idx);
+    if (!slot) {
+        return false;
+    }
+
+    // Backward shift deletion, no tombstones.
+    const size_t mask = r_hashmap->capacity - 1;
+    size_t next = (idx + 1) & mask;
+    MapSlot *next_slot = hashmap_slot(r_hashmap, next);
+    while (next_slot->distance > 1) {
+        memcpy(slot, next_slot, r_hashmap->slot_size);
+        slot->distance--;
+
+        slot = next_slot;
+        next = (next + 1) & mask;
+        next_slot = hashmap_slot(r_hashmap, next);
+    }
+    slot->distance = 0;
+
+    r_hashmap->keys_live -= key_length;
+    r_hashmap->size--;
+    return true;
+}
+
+void hashmap_clear(HashMap *r_hashmap) {
+    if (r_hashmap->slots) {
+        memset(r_hashmap->slots, 0, r_hashmap->slot_size * r_hashmap->capacity);
     }
-    return NULL;
+    r_hashmap->size = 0;
+    r_hashmap->keys_live = 0;
+    r_hashmap->keys_size = 0;
 }
@@ -2,15 +2,28 @@
 #define HASH_MAP_H_
 
 #include <stdlib.h>
+#include <stdbool.h>
 
+// Open addressing (Robin Hood) map from string keys to fixed size values.
+// Keys are compared up to the first NULL or p_key_size bytes, whichever comes first.
 typedef struct HashMap HashMap;
 
 HashMap *hashmap_create(size_t value_size);
 
 void hashmap_free(HashMap *r_hashmap);
 
+void hashmap_reserve(HashMap *r_hashmap, size_t p_count);
+
+size_t hashmap_size(const HashMap *p_hashmap);
+
+size_t hashmap_capacity(const HashMap *p_hashmap);
+
 void hashmap_insert(HashMap *r_hashmap, const char *p_key, size_t p_key_size, const void *p_data);
 
 void *hashmap_get(HashMap *r_hashmap, const char *p_key, size_t p_key_size);
 
+bool hashmap_remove(HashMap *r_hashmap, const char *p_key, size_t p_key_size);
+
+void hashmap_clear(HashMap *r_hashmap);
+
 #endif
@@ -0,0 +1,203 @@
+#include "int_map.h"
+
+#include <string.h>
+
+#include "src/io/memory.h"
+#include "src/error/error.h"
+
+#define INTMAP_MIN_CAPACITY 16
+
+// distance is the probe length + 1, with 0 marking an empty slot.
+typedef struct IntMapSlot {
+    uint64_t key;
+    uint32_t value;
+    uint32_t distance;
+} IntMapSlot;
+
+struct IntMap {
+    size_t size;
+    size_t capacity;
+    IntMapSlot *slots;
+};
+
+static inline uint64_t intmap_hash(uint64_t p_key) {
+    // splitmix64 finaliser.
+    p_key ^= p_key >> 30;
+    p_key *= 0xbf58476d1ce4e5b9ULL;
+    p_key ^= p_key >> 27;
+    p_key *= 0x94d049bb133111ebULL;
+    p_key ^= p_key >> 31;
+    return p_key;
+}
+
+// Robin Hood placement starting at p_idx, returns where p_slot ended up.
+static IntMapSlot *intmap_place(IntMap *r_intmap, size_t p_idx, IntMapSlot p_slot) {
+    const size_t mask = r_intmap->capacity - 1;
+    IntMapSlot *placed = NULL;
+    while (true) {
+        IntMapSlot *slot = &r_intmap->slots[p_idx];
+        if (slot->distance == 0) {
+            *slot = p_slot;
+            return placed ? placed : slot;
+        }
+
+        if (slot->distance < p_slot.distance) {
+            IntMapSlot swap = *slot;
+            *slot = p_slot;
+            p_slot = swap;
+            if (!placed) {
+                placed = slot;
+            }
+        }
+
+        p_slot.distance++;
+        p_idx = (p_idx + 1) & mask;
+    }
+}
+
+static void intmap_rehash(IntMap *r_intmap, size_t p_capacity) {
+    IntMapSlot *old_slots = r_intmap->slots;
+    const size_t old_capacity = r_intmap->capacity;
+
+    r_intmap->capacity = p_capacity;
+    r_intmap->slots = mmalloc(sizeof(IntMapSlot) * p_capacity);
+    memset(r_intmap->slots, 0, sizeof(IntMapSlot) * p_capacity);
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_slots[i].distance == 0) {
+            continue;
+        }
+        IntMapSlot slot = old_slots[i];
+        slot.distance = 1;
+        intmap_place(r_intmap, intmap_hash(slot.key) & (p_capacity - 1), slot);
+    }
+
+    mfree(old_slots);
+}
+
+static IntMapSlot *intmap_find(const IntMap *p_intmap, uint64_t p_key, size_t *r_idx) {
+    if (p_intmap->capacity == 0) {
+        return NULL;
+    }
+
+    const size_t mask = p_intmap->capacity - 1;
+    size_t idx = intmap_hash(p_key) & mask;
+    uint32_t distance = 1;
+    while (true) {
+        IntMapSlot *slot = &p_intmap->slots[idx];
+        if (slot->distance < distance) {
+            return NULL;
+        }
+        if (slot->key == p_key) {
+            if (r_idx) {
+                *r_idx = idx;
+            }
+            return slot;
+        }
+        distance++;
+        idx = (idx + 1) & mask;
+    }
+}
+
+IntMap *intmap_create(void) {
+    IntMap *map = mmalloc(sizeof(IntMap));
+    map->size = 0;
+    map->capacity = 0;
+    map->slots = NULL;
+    return map;
+}
+
+void intmap_free(IntMap *r_intmap) {
+    mfree(r_intmap->slots);
+    mfree(r_intmap);
+}
+
+void intmap_reserve(IntMap *r_intmap, size_t p_count) {
+    // Keep the load factor under 7/8.
+    size_t capacity = INTMAP_MIN_CAPACITY;
+    while (capacity - (capacity / 8) < p_count) {
+        capacity *= 2;
+    }
+
+    if (capacity > r_intmap->capacity) {
+        intmap_rehash(r_intmap, capacity);
+    }
+}
+
+size_t intmap_size(const IntMap *p_intmap) {
+    return p_intmap->size;
+}
+
+uint32_t *intmap_get_or_insert(IntMap *r_intmap, uint64_t p_key, uint32_t p_value, bool *r_inserted) {
+    intmap_reserve(r_intmap, r_intmap->size + 1);
+
+    const size_t mask = r_intmap->capacity - 1;
+    size_t idx = intmap_hash(p_key) & mask;
+    uint32_t distance = 1;
+    while (true) {
+        IntMapSlot *slot = &r_intmap->slots[idx];
+        if (slot->distance < distance) {
+            break;
+        }
+        if (slot->key == p_key) {
+            if (r_inserted) {
+                *r_inserted = false;
+            }
+            return &slot->value;
+        }
+        distance++;
+        idx = (idx + 1) & mask;
+    }
+
+    IntMapSlot *placed = intmap_place(r_intmap, idx, (IntMapSlot){ .key = p_key, .value = p_value, .distance = distance });
+    r_intmap->size++;
+    if (r_inserted) {
+        *r_inserted = true;
+    }
+    return &placed->value;
+}
+
+void intmap_insert(IntMap *r_intmap, uint64_t p_key, uint32_t p_value) {
+    bool inserted = false;
+    uint32_t *value = intmap_get_or_insert(r_intmap, p_key, p_value, &inserted);
+    if (!inserted) {
+        *value = p_value;
+    }
+}
+
+uint32_t *intmap_get(IntMap *r_intmap, uint64_t p_key) {
+    IntMapSlot *slot = intmap_find(r_intmap, p_key, NULL);
+    if (!slot) {
+        return NULL;
+    }
+    return &slot->value;
+}
+
+bool intmap_remove(IntMap *r_intmap, uint64_t p_key) {
+    size_t idx = 0;
+    IntMapSlot *slot = intmap_find(r_intmap, p_key, &idx);
+    if (!slot) {
+        return false;
+    }
+
+    // Backward shift deletion, no tombstones.
+    const size_t mask = r_intmap->capacity - 1;
+    size_t next = (idx + 1) & mask;
+    while (r_intmap->slots[next].distance > 1) {
+        r_intmap->slots[idx] = r_intmap->slots[next];
+        r_intmap->slots[idx].distance--;
+        idx = next;
+        next = (next + 1) & mask;
+    }
+    r_intmap->slots[idx].distance = 0;
+
+    r_intmap->size--;
+    return true;
+}
+
+void intmap_clear(IntMap *r_intmap) {
+    if (r_intmap->slots) {
+        memset(r_intmap->slots, 0, sizeof(IntMapSlot) * r_intmap->capacity);
+    }
+    r_intmap->size = 0;
+}
@@ -0,0 +1,30 @@
+#ifndef INT_MAP_H_
+#define INT_MAP_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Open addressing (Robin Hood) map specialised for uint64_t keys and uint32_t values.
+typedef struct IntMap IntMap;
+
+IntMap *intmap_create(void);
+
+void intmap_free(IntMap *r_intmap);
+
+void intmap_reserve(IntMap *r_intmap, size_t p_count);
+
+size_t intmap_size(const IntMap *p_intmap);
+
+void intmap_insert(IntMap *r_intmap, uint64_t p_key, uint32_t p_value);
+
+// Returns the existing value, or inserts p_value and returns it, with a single probe.
+uint32_t *intmap_get_or_insert(IntMap *r_intmap, uint64_t p_key, uint32_t p_value, bool *r_inserted);
+
+uint32_t *intmap_get(IntMap *r_intmap, uint64_t p_key);
+
+bool intmap_remove(IntMap *r_intmap, uint64_t p_key);
+
+void intmap_clear(IntMap *r_intmap);
+
+#endif
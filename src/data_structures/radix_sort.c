@@ -0,0 +1,60 @@
+#include "radix_sort.h"
+
+#include <string.h>
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES (64 / RADIX_BITS)
+
+void radix_sort_u64(uint64_t *r_keys, uint32_t *r_values, uint64_t *r_key_scratch, uint32_t *r_value_scratch, size_t p_count) {
+    if (p_count < 2) {
+        return;
+    }
+
+    // Every histogram in one read of the keys
+    size_t counts[RADIX_PASSES][RADIX_BUCKETS];
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < p_count; i++) {
+        const uint64_t key = r_keys[i];
+        for (uint32_t pass = 0; pass < RADIX_PASSES; pass++) {
+            counts[pass][(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+        }
+    }
+
+    uint64_t *keys = r_keys;
+    uint32_t *values = r_values;
+    uint64_t *keys_out = r_key_scratch;
+    uint32_t *values_out = r_value_scratch;
+    for (uint32_t pass = 0; pass < RADIX_PASSES; pass++) {
+        const uint32_t shift = pass * RADIX_BITS;
+        size_t *pass_counts = counts[pass];
+        if (pass_counts[(keys[0] >> shift) & (RADIX_BUCKETS - 1)] == p_count) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (uint32_t bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+            const size_t count = pass_counts[bucket];
+            pass_counts[bucket] = offset;
+            offset += count;
+        }
+
+        for (size_t i = 0; i < p_count; i++) {
+            const size_t dest = pass_counts[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+            keys_out[dest] = keys[i];
+            values_out[dest] = values[i];
+        }
+
+        uint64_t *swap_keys = keys;
+        keys = keys_out;
+        keys_out = swap_keys;
+        uint32_t *swap_values = values;
+        values = values_out;
+        values_out = swap_values;
+    }
+
+    if (keys != r_keys) {
+        memcpy(r_keys, keys, sizeof(uint64_t) * p_count);
+        memcpy(r_values, values, sizeof(uint32_t) * p_count);
+    }
+}
@@ -0,0 +1,12 @@
+#ifndef RADIX_SORT_H_
+#define RADIX_SORT_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+
+// Stable least significant byte first sort of r_keys, r_values is moved along with them.
+// The scratch arrays must hold p_count elements. Bytes that are equal across all keys are
+// skipped, so keys leaving their high bits unused cost fewer passes.
+void radix_sort_u64(uint64_t *r_keys, uint32_t *r_values, uint64_t *r_key_scratch, uint32_t *r_value_scratch, size_t p_count);
+
+#endif
@@ -0,0 +1,204 @@
+#include "slot_map.h"
+
+#include <string.h>
+
+#include "src/io/memory.h"
+#include "src/error/error.h"
+
+#define SLOT_MAP_FREE_END UINT32_MAX
+
+static inline uint32_t slot_handle_index(SlotHandle p_handle) {
+    return (uint32_t)(p_handle & SLOT_HANDLE_INDEX_MASK);
+}
+
+static inline uint32_t slot_handle_generation(SlotHandle p_handle) {
+    return (uint32_t)(p_handle >> SLOT_HANDLE_INDEX_BITS);
+}
+
+static inline SlotHandle slot_handle_make(uint32_t p_index, uint32_t p_generation) {
+    return ((SlotHandle)p_generation << SLOT_HANDLE_INDEX_BITS) | p_index;
+}
+
+static SlotMapSlot *slot_map_lookup(const SlotMap *p_slot_map, SlotHandle p_handle) {
+    const uint32_t idx = slot_handle_index(p_handle);
+    if (p_handle == SLOT_HANDLE_INVALID || idx >= p_slot_map->slots.size) {
+        return NULL;
+    }
+
+    SlotMapSlot *slot = slot_map_slot_vector_get(&p_slot_map->slots, idx);
+    if (slot->generation != slot_handle_generation(p_handle)) {
+        return NULL;
+    }
+    return slot;
+}
+
+static void slot_map_clear_name(SlotMap *r_slot_map, SlotMapSlot *r_slot) {
+    if (!r_slot->name) {
+        return;
+    }
+    const size_t name_size = strlen(r_slot->name) + 1;
+    hashmap_remove(r_slot_map->names, r_slot->name, name_size);
+    pool_free(r_slot->name, name_size);
+    r_slot->name = NULL;
+}
+
+void slot_map_init(SlotMap *r_slot_map, size_t p_data_size) {
+    r_slot_map->dense = (Vector){0, 0, p_data_size, NULL};
+    r_slot_map->dense_slots = (U32Vector){ 0 };
+    r_slot_map->slots = (SlotMapSlotVector){ 0 };
+    r_slot_map->free_head = SLOT_MAP_FREE_END;
+    r_slot_map->free_tail = SLOT_MAP_FREE_END;
+    r_slot_map->names = NULL;
+}
+
+void slot_map_free(SlotMap *r_slot_map) {
+    for (size_t i = 0; i < r_slot_map->slots.size; i++) {
+        if (r_slot_map->slots.data[i].name) {
+            pool_free(r_slot_map->slots.data[i].name, strlen(r_slot_map->slots.data[i].name) + 1);
+        }
+    }
+    if (r_slot_map->names) {
+        hashmap_free(r_slot_map->names);
+    }
+    vector_free(&r_slot_map->dense);
+    u32_vector_free(&r_slot_map->dense_slots);
+    slot_map_slot_vector_free(&r_slot_map->slots);
+    r_slot_map->free_head = SLOT_MAP_FREE_END;
+    r_slot_map->free_tail = SLOT_MAP_FREE_END;
+    r_slot_map->names = NULL;
+}
+
+void slot_map_reserve(SlotMap *r_slot_map, size_t p_capacity) {
+    vector_reserve(&r_slot_map->dense, p_capacity);
+    u32_vector_reserve(&r_slot_map->dense_slots, p_capacity);
+    slot_map_slot_vector_reserve(&r_slot_map->slots, p_capacity);
+}
+
+SlotHandle slot_map_add(SlotMap *r_slot_map, const void *p_data) {
+    uint32_t idx = r_slot_map->free_head;
+    if (idx != SLOT_MAP_FREE_END) {
+        r_slot_map->free_head = r_slot_map->slots.data[idx].dense_idx;
+        if (r_slot_map->free_head == SLOT_MAP_FREE_END) {
+            r_slot_map->free_tail = SLOT_MAP_FREE_END;
+        }
+    } else {
+        ERR_FAIL_COND_V(r_slot_map->slots.size >= SLOT_MAP_MAX_SIZE, SLOT_HANDLE_INVALID);
+        idx = r_slot_map->slots.size;
+        slot_map_slot_vector_push_back(&r_slot_map->slots, (SlotMapSlot){ .dense_idx = 0, .generation = 1, .name = NULL });
+    }
+
+    SlotMapSlot *slot = slot_map_slot_vector_get(&r_slot_map->slots, idx);
+    slot->dense_idx = r_slot_map->dense.size;
+
+    vector_push_back(&r_slot_map->dense, p_data);
+    u32_vector_push_back(&r_slot_map->dense_slots, idx);
+
+    return slot_handle_make(idx, slot->generation);
+}
+
+bool slot_map_remove(SlotMap *r_slot_map, SlotHandle p_handle) {
+    SlotMapSlot *slot = slot_map_lookup(r_slot_map, p_handle);
+    if (!slot) {
+        return false;
+    }
+    slot_map_clear_name(r_slot_map, slot);
+
+    // Move the last element into the gap.
+    const uint32_t dense_idx = slot->dense_idx;
+    const uint32_t last_idx = r_slot_map->dense.size - 1;
+    if (dense_idx != last_idx) {
+        const size_t data_size = r_slot_map->dense.data_size;
+        memcpy((char *)r_slot_map->dense.data + (dense_idx * data_size), (char *)r_slot_map->dense.data + (last_idx * data_size), data_size);
+
+        const uint32_t moved_slot = r_slot_map->dense_slots.data[last_idx];
+        r_slot_map->dense_slots.data[dense_idx] = moved_slot;
+        r_slot_map->slots.data[moved_slot].dense_idx = dense_idx;
+    }
+    r_slot_map->dense.size--;
+    r_slot_map->dense_slots.size--;
+
+    // Bump the generation so old handles go stale. Wrapping would let one validate again, so a saturated
+    // slot is retired with generation 0, which no handle ever carries, and never goes back on the free list.
+    if (slot->generation == SLOT_HANDLE_GENERATION_MAX) {
+        slot->generation = 0;
+        slot->dense_idx = SLOT_MAP_FREE_END;
+        return true;
+    }
+    slot->generation++;
+
+    const uint32_t idx = slot_handle_index(p_handle);
+    slot->dense_idx = SLOT_MAP_FREE_END;
+    if (r_slot_map->free_tail != SLOT_MAP_FREE_END) {
+        r_slot_map->slots.data[r_slot_map->free_tail].dense_idx = idx;
+    } else {
+        r_slot_map->free_head = idx;
+    }
+    r_slot_map->free_tail = idx;
+    return true;
+}
+
+void *slot_map_get(const SlotMap *p_slot_map, SlotHandle p_handle) {
+    const SlotMapSlot *slot = slot_map_lookup(p_slot_map, p_handle);
+    if (!slot) {
+        return NULL;
+    }
+    return vector_get(&p_slot_map->dense, slot->dense_idx);
+}
+
+bool slot_map_contains(const SlotMap *p_slot_map, SlotHandle p_handle) {
+    return slot_map_lookup(p_slot_map, p_handle) != NULL;
+}
+
+size_t slot_map_size(const SlotMap *p_slot_map) {
+    return p_slot_map->dense.size;
+}
+
+void *slot_map_dense(const SlotMap *p_slot_map) {
+    return p_slot_map->dense.data;
+}
+
+SlotHandle slot_map_dense_handle(const SlotMap *p_slot_map, size_t p_dense_idx) {
+    ERR_FAIL_COND_V(p_dense_idx >= p_slot_map->dense.size, SLOT_HANDLE_INVALID);
+    const uint32_t idx = p_slot_map->dense_slots.data[p_dense_idx];
+    return slot_handle_make(idx, p_slot_map->slots.data[idx].generation);
+}
+
+void slot_map_set_name(SlotMap *r_slot_map, SlotHandle p_handle, const char *p_name) {
+    SlotMapSlot *slot = slot_map_lookup(r_slot_map, p_handle);
+    ERR_FAIL_COND(!slot);
+
+    slot_map_clear_name(r_slot_map, slot);
+    if (!p_name) {
+        return;
+    }
+
+    if (!r_slot_map->names) {
+        r_slot_map->names = hashmap_create(sizeof(SlotHandle));
+    }
+
+    // Names are unique, steal it from any previous owner.
+    const size_t name_size = strlen(p_name) + 1;
+    SlotHandle *previous = hashmap_get(r_slot_map->names, p_name, name_size);
+    if (previous) {
+        SlotMapSlot *previous_slot = slot_map_lookup(r_slot_map, *previous);
+        if (previous_slot) {
+            slot_map_clear_name(r_slot_map, previous_slot);
+        }
+    }
+
+    slot->name = pool_alloc(name_size);
+    memcpy(slot->name, p_name, name_size);
+    hashmap_insert(r_slot_map->names, p_name, name_size, &p_handle);
+}
+
+SlotHandle slot_map_find(SlotMap *r_slot_map, const char *p_name) {
+    if (!r_slot_map->names) {
+        return SLOT_HANDLE_INVALID;
+    }
+
+    const SlotHandle *handle = hashmap_get(r_slot_map->names, p_name, strlen(p_name) + 1);
+    if (!handle) {
+        return SLOT_HANDLE_INVALID;
+    }
+    return *handle;
+}
@@ -0,0 +1,72 @@
+#ifndef SLOT_MAP_H_
+#define SLOT_MAP_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "vector.h"
+#include "hash_map.h"
+
+// Handles pack a slot index in the low 32 bits and a generation in the high 32 bits.
+// A handle goes stale once its element is removed, 0 is never a valid handle.
+// Generations never wrap, a slot whose generation saturates is retired instead of reused.
+typedef uint64_t SlotHandle;
+
+#define SLOT_HANDLE_INVALID 0
+#define SLOT_HANDLE_INDEX_BITS 32
+#define SLOT_HANDLE_INDEX_MASK 0xffffffffull
+#define SLOT_HANDLE_GENERATION_MAX UINT32_MAX
+#define SLOT_MAP_MAX_SIZE (UINT32_MAX - 1) // UINT32_MAX ends the free list
+
+typedef struct SlotMapSlot {
+    uint32_t dense_idx; // Next free slot when not in use
+    uint32_t generation;
+    char *name;
+} SlotMapSlot;
+
+VECTOR_DEFINE(SlotMapSlotVector, slot_map_slot_vector, SlotMapSlot)
+#define slot_map_slot_vector_reserve(...) slot_map_slot_vector_reserve(VECTOR_SITE(__VA_ARGS__))
+#define slot_map_slot_vector_push_back(...) slot_map_slot_vector_push_back(VECTOR_SITE(__VA_ARGS__))
+#define slot_map_slot_vector_extend_uninitialized(...) slot_map_slot_vector_extend_uninitialized(VECTOR_SITE(__VA_ARGS__))
+#define slot_map_slot_vector_append_range(...) slot_map_slot_vector_append_range(VECTOR_SITE(__VA_ARGS__))
+#define slot_map_slot_vector_clone(...) slot_map_slot_vector_clone(VECTOR_SITE(__VA_ARGS__))
+
+// Elements are kept packed in dense for iteration, removal swaps the last element into the gap.
+// Pointers into dense are only valid until the next add or remove, hold handles instead.
+typedef struct SlotMap {
+    Vector dense;
+    U32Vector dense_slots;
+    SlotMapSlotVector slots;
+    // Removed slots are reused oldest first, so a slot churned every frame goes through its generations
+    // as slowly as possible.
+    uint32_t free_head;
+    uint32_t free_tail;
+    HashMap *names;
+} SlotMap;
+
+void slot_map_init(SlotMap *r_slot_map, size_t p_data_size);
+
+void slot_map_free(SlotMap *r_slot_map);
+
+void slot_map_reserve(SlotMap *r_slot_map, size_t p_capacity);
+
+SlotHandle slot_map_add(SlotMap *r_slot_map, const void *p_data);
+
+bool slot_map_remove(SlotMap *r_slot_map, SlotHandle p_handle);
+
+void *slot_map_get(const SlotMap *p_slot_map, SlotHandle p_handle);
+
+bool slot_map_contains(const SlotMap *p_slot_map, SlotHandle p_handle);
+
+size_t slot_map_size(const SlotMap *p_slot_map);
+
+void *slot_map_dense(const SlotMap *p_slot_map);
+
+SlotHandle slot_map_dense_handle(const SlotMap *p_slot_map, size_t p_dense_idx);
+
+void slot_map_set_name(SlotMap *r_slot_map, SlotHandle p_handle, const char *p_name);
+
+SlotHandle slot_map_find(SlotMap *r_slot_map, const char *p_name);
+
+#endif
@@ -13,6 +13,14 @@ void vector_resize(Vector *r_vector, const size_t p_size) {
     }
 }
 
+void vector_reserve(Vector *r_vector, const size_t p_capacity) {
+    if (p_capacity <= r_vector->capacity) {
+        return;
+    }
+    r_vector->data = mrealloc(r_vector->data, r_vector->data_size * p_capacity);
+    r_vector->capacity = p_capacity;
+}
+
 void vector_set(Vector *r_vector, const size_t p_idx, const void *p_data) {
     ERR_FAIL_UINDEX(p_idx, r_vector->size);
     memcpy(r_vector->data + (p_idx * r_vector->data_size), p_data, r_vector->data_size);
@@ -28,7 +36,8 @@ void vector_push_back(Vector *r_vector, const void *p_data) {
         r_vector->capacity = new_size;
     }
 
-    vector_set(r_vector, r_vector->size++, p_data);
+    // Index is known to be valid, skip the bounds check in vector_set.
+    memcpy(r_vector->data + (r_vector->size++ * r_vector->data_size), p_data, r_vector->data_size);
 }
 
 void *vector_get(const Vector *p_vector, const size_t p_idx) {
@@ -36,9 +45,18 @@ void *vector_get(const Vector *p_vector, const size_t p_idx) {
 }
 
 void vector_copy(const Vector *p_src, Vector *r_dst) {
-    for (size_t i = 0; i < p_src->size; i++) {
-        vector_push_back(r_dst, p_src->data + (i * p_src->data_size));
+    if (p_src->size == 0) {
+        return;
     }
+
+    size_t capacity = r_dst->capacity == 0 ? 1 : r_dst->capacity;
+    while (capacity < r_dst->size + p_src->size) {
+        capacity *= 2;
+    }
+    vector_reserve(r_dst, capacity);
+
+    memcpy(r_dst->data + (r_dst->size * r_dst->data_size), p_src->data, p_src->size * p_src->data_size);
+    r_dst->size += p_src->size;
 }
 
 void vector_free(Vector *r_vector) {
@@ -2,6 +2,10 @@
 #define VECTOR_H_
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "src/io/memory.h"
 
 typedef struct Vector {
     size_t capacity;
@@ -12,6 +16,8 @@ typedef struct Vector {
 
 void vector_resize(Vector *r_vector, const size_t p_size);
 
+void vector_reserve(Vector *r_vector, const size_t p_capacity);
+
 void vector_set(Vector *r_vector, const size_t p_idx, const void *p_data);
 
 void vector_push_back(Vector *r_vector, const void *p_data);
@@ -22,4 +28,88 @@ void vector_copy(const Vector *p_src, Vector *r_dst);
 
 void vector_free(Vector *r_vector);
 
+/// Typed vector
+
+// Generates a vector with a compile time element size, so access inlines to plain loads and stores.
+// VECTOR_DEFINE(VertexVector, vertex_vector, Vertex) gives VertexVector and vertex_vector_*().
+// Zero initialise before use, e.g. VertexVector vertexes = { 0 };
+// Functions that may allocate take their caller's site last. Follow the definition with a wrapper per function,
+// see U32Vector below, so plain calls like vertex_vector_push_back(&vertexes, vertex) pass __FILE__ and __LINE__.
+#define VECTOR_DEFINE(m_vector, m_prefix, m_type)                                                                   \
+    typedef struct m_vector {                                                                                       \
+        size_t capacity;                                                                                            \
+        size_t size;                                                                                                \
+        m_type *data;                                                                                               \
+    } m_vector;                                                                                                     \
+                                                                                                                    \
+    static inline void m_prefix##_reserve(m_vector *r_vector, const size_t p_capacity, const char *p_file, int p_line) { \
+        if (p_capacity <= r_vector->capacity) {                                                                     \
+            return;                                                                                                 \
+        }                                                                                                           \
+        r_vector->data = mrealloc_site(r_vector->data, sizeof(m_type) * p_capacity);                                \
+        r_vector->capacity = p_capacity;                                                                            \
+    }                                                                                                               \
+                                                                                                                    \
+    static inline void m_prefix##_grow(m_vector *r_vector, const size_t p_size, const char *p_file, int p_line) {   \
+        size_t new_capacity = r_vector->capacity == 0 ? 1 : r_vector->capacity * 2;                                \
+        while (new_capacity < p_size) {                                                                             \
+            new_capacity *= 2;                                                                                      \
+        }                                                                                                           \
+        m_prefix##_reserve(r_vector, new_capacity, p_file, p_line);                                                 \
+    }                                                                                                               \
+                                                                                                                    \
+    static inline void m_prefix##_push_back(m_vector *r_vector, const m_type p_value, const char *p_file, int p_line) { \
+        if (r_vector->size == r_vector->capacity) {                                                                 \
+            m_prefix##_grow(r_vector, r_vector->size + 1, p_file, p_line);                                          \
+        }                                                                                                           \
+        r_vector->data[r_vector->size++] = p_value;                                                                 \
+    }                                                                                                               \
+                                                                                                                    \
+    static inline m_type *m_prefix##_get(const m_vector *p_vector, const size_t p_idx) {                            \
+        return &p_vector->data[p_idx];                                                                              \
+    }                                                                                                               \
+                                                                                                                    \
+    /* Grows by p_count elements and returns them for the caller to fill. */                                        \
+    static inline m_type *m_prefix##_extend_uninitialized(m_vector *r_vector, const size_t p_count, const char *p_file, int p_line) { \
+        if (r_vector->size + p_count > r_vector->capacity) {                                                        \
+            m_prefix##_grow(r_vector, r_vector->size + p_count, p_file, p_line);                                    \
+        }                                                                                                           \
+        m_type *start = r_vector->data + r_vector->size;                                                            \
+        r_vector->size += p_count;                                                                                  \
+        return start;                                                                                               \
+    }                                                                                                               \
+                                                                                                                    \
+    static inline void m_prefix##_append_range(m_vector *r_vector, const m_type *p_data, const size_t p_count, const char *p_file, int p_line) { \
+        if (p_count == 0) {                                                                                         \
+            return;                                                                                                 \
+        }                                                                                                           \
+        memcpy(m_prefix##_extend_uninitialized(r_vector, p_count, p_file, p_line), p_data, sizeof(m_type) * p_count); \
+    }                                                                                                               \
+                                                                                                                    \
+    /* r_dst is overwritten, it must be zero initialised or previously freed. */                                    \
+    static inline void m_prefix##_clone(const m_vector *p_src, m_vector *r_dst, const char *p_file, int p_line) {   \
+        *r_dst = (m_vector){ 0, 0, NULL };                                                                          \
+        m_prefix##_append_range(r_dst, p_src->data, p_src->size, p_file, p_line);                                   \
+    }                                                                                                               \
+                                                                                                                    \
+    static inline void m_prefix##_clear(m_vector *r_vector) {                                                       \
+        r_vector->size = 0;                                                                                         \
+    }                                                                                                               \
+                                                                                                                    \
+    static inline void m_prefix##_free(m_vector *r_vector) {                                                        \
+        mfree(r_vector->data);                                                                                      \
+        *r_vector = (m_vector){ 0, 0, NULL };                                                                       \
+    }
+
+// Wrappers the preprocessor cannot emit from VECTOR_DEFINE, one line per allocating function.
+// A type without them fails to compile in every build, not only with memory_debug=yes.
+#define VECTOR_SITE(...) __VA_ARGS__, __FILE__, __LINE__
+
+VECTOR_DEFINE(U32Vector, u32_vector, uint32_t)
+#define u32_vector_reserve(...) u32_vector_reserve(VECTOR_SITE(__VA_ARGS__))
+#define u32_vector_push_back(...) u32_vector_push_back(VECTOR_SITE(__VA_ARGS__))
+#define u32_vector_extend_uninitialized(...) u32_vector_extend_uninitialized(VECTOR_SITE(__VA_ARGS__))
+#define u32_vector_append_range(...) u32_vector_append_range(VECTOR_SITE(__VA_ARGS__))
+#define u32_vector_clone(...) u32_vector_clone(VECTOR_SITE(__VA_ARGS__))
+
 #endif
@@ -6,6 +6,7 @@
 #include <SDL2/SDL_vulkan.h>
 #include "src/io/memory.h"
 #include "src/error/error.h"
+#include "src/jobs/jobs.h"
 
 
 Engine *engine_create(size_t p_width, size_t p_height) {
@@ -19,17 +20,43 @@ Engine *engine_create(size_t p_width, size_t p_height) {
     engine->uptime = 0;
     engine->frames = 0;
 
+    // One thread per core, the main thread included
+    job_system_init(SDL_max(SDL_GetCPUCount() - 1, 0));
+
     vk_window_create(&engine->window, "Toy Vk Renderer", p_width, p_height);
     vk_renderer_create(&engine->renderer, &engine->window, 2);
     camera_init(&engine->camera);
-    engine->objects = (Vector) {0, 0, sizeof(Object), NULL};
+    slot_map_init(&engine->objects, sizeof(Object));
+    arena_init(&engine->frame_arena, 1024 * 1024);
 
     return engine;
 }
 
-void engine_add_object(Engine *p_engine, Object *p_object) {
-    // TODO: Support named entities
-    vector_push_back(&p_engine->objects, p_object);
+ObjectHandle engine_add_object(Engine *p_engine, const Object *p_object) {
+    return slot_map_add(&p_engine->objects, p_object);
+}
+
+ObjectHandle engine_add_named_object(Engine *p_engine, const char *p_name, const Object *p_object) {
+    ObjectHandle handle = slot_map_add(&p_engine->objects, p_object);
+    slot_map_set_name(&p_engine->objects, handle, p_name);
+    return handle;
+}
+
+bool engine_remove_object(Engine *p_engine, ObjectHandle p_handle) {
+    Object *object = slot_map_get(&p_engine->objects, p_handle);
+    if (!object) {
+        return false;
+    }
+    surface_release(&p_engine->renderer, &object->surface);
+    return slot_map_remove(&p_engine->objects, p_handle);
+}
+
+Object *engine_get_object(Engine *p_engine, ObjectHandle p_handle) {
+    return slot_map_get(&p_engine->objects, p_handle);
+}
+
+ObjectHandle engine_find_object(Engine *p_engine, const char *p_name) {
+    return slot_map_find(&p_engine->objects, p_name);
 }
 
 void engine_run(Engine *p_engine) {
@@ -45,7 +72,14 @@ void engine_run(Engine *p_engine) {
     int32_t tick = 0;
     p_engine->uptime = 0;
 
+#ifdef MEMORY_DEBUG
+    MemoryStats memory_stats;
+    memory_get_stats(&memory_stats);
+    size_t last_allocations = memory_stats.total_allocations;
+#endif
+
     bool mouse_capture = false;
+    bool log_draw_stats = false;
     bool running = true;
     while (running) {
         Uint32 now = SDL_GetTicks();
@@ -73,6 +107,27 @@ void engine_run(Engine *p_engine) {
                     p_engine->renderer.frag_push_constants.lighting_enabled = !p_engine->renderer.frag_push_constants.lighting_enabled;
                 }
 
+                if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_m) {
+                    memory_dump_stats();
+                    gpu_allocator_dump_stats(&p_engine->renderer.gpu_allocator);
+                }
+
+                if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_b) {
+                    log_draw_stats = !log_draw_stats;
+                }
+
+                if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_k) {
+                    p_engine->renderer.lod_enabled = !p_engine->renderer.lod_enabled;
+                }
+
+                if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_g) {
+                    p_engine->renderer.gpu_culling = !p_engine->renderer.gpu_culling && p_engine->renderer.gpu_culling_supported;
+                }
+
+                if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_c) {
+                    p_engine->renderer.meshlet_culling = !p_engine->renderer.meshlet_culling && p_engine->renderer.meshlet_culling_supported;
+                }
+
                 if (event.key.keysym.sym == SDLK_ESCAPE) {
                     mouse_capture = false;
                     SDL_SetRelativeMouseMode(SDL_FALSE);
@@ -89,12 +144,26 @@ void engine_run(Engine *p_engine) {
         }
         fps++;
 
-        vk_draw_frame(&p_engine->renderer, &p_engine->window, &p_engine->camera, &p_engine->objects);
+        arena_reset(&p_engine->frame_arena);
+        vk_draw_frame(&p_engine->renderer, &p_engine->window, &p_engine->camera, &p_engine->objects, &p_engine->frame_arena);
 
         if (SDL_GetTicks() - timer > 1000) {
             timer += 1000;
             p_engine->uptime++;
             p_engine->frames = fps;
+
+            if (log_draw_stats) {
+                const DrawStats *stats = &p_engine->renderer.draw_stats;
+                INFO_MSG("Draws: %u objects, %u instances, %u triangles, %u meshlets, %u runs, %u draw calls. Binds: %u pipeline, %u descriptor set, %u vertex buffer, %u index buffer",
+                    stats->objects, stats->instances, stats->triangles, stats->meshlets, stats->runs, stats->draw_calls, stats->pipeline_binds, stats->descriptor_set_binds, stats->vertex_buffer_binds, stats->index_buffer_binds);
+            }
+
+#ifdef MEMORY_DEBUG
+            // Anything above zero in a steady scene is a per-frame allocation.
+            memory_get_stats(&memory_stats);
+            INFO_MSG("Allocations per frame: %.2f, live: %zu bytes", (double)(memory_stats.total_allocations - last_allocations) / (fps > 0 ? fps : 1), memory_stats.live_bytes);
+            last_allocations = memory_stats.total_allocations;
+#endif
             fps = 0;
             tick = 0;
         }
@@ -102,5 +171,16 @@ void engine_run(Engine *p_engine) {
 }
 
 void engine_cleanup(Engine *p_engine) {
+    Object *objects = slot_map_dense(&p_engine->objects);
+    for (size_t i = 0; i < slot_map_size(&p_engine->objects); i++) {
+        surface_release(&p_engine->renderer, &objects[i].surface);
+    }
+    slot_map_free(&p_engine->objects);
+
+    vk_renderer_free(&p_engine->renderer, &p_engine->window);
+    vk_window_free(&p_engine->window);
+    arena_free(&p_engine->frame_arena);
     mfree(p_engine);
+    job_system_shutdown();
+    arena_scratch_free();
 }
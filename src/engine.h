@@ -6,6 +6,7 @@
 #include "src/vulkan/vk_renderer.h"
 #include "src/camera.h"
 #include "src/object.h"
+#include "src/io/memory.h"
 
 typedef struct Engine {
     int32_t max_ticks;
@@ -18,12 +19,25 @@ typedef struct Engine {
     VkRenderer renderer;
 
     Camera camera;
-    Vector objects;
+    SlotMap objects;
+
+    // Transient allocations, reset at the start of every frame.
+    Arena frame_arena;
 } Engine;
 
 Engine *engine_create(size_t p_width, size_t p_height);
 
-void engine_add_object(Engine *p_engine, Object *p_object);
+// The engine takes over the references held by p_object->surface and releases them when the
+// object is removed or the engine is cleaned up.
+ObjectHandle engine_add_object(Engine *p_engine, const Object *p_object);
+
+ObjectHandle engine_add_named_object(Engine *p_engine, const char *p_name, const Object *p_object);
+
+bool engine_remove_object(Engine *p_engine, ObjectHandle p_handle);
+
+Object *engine_get_object(Engine *p_engine, ObjectHandle p_handle);
+
+ObjectHandle engine_find_object(Engine *p_engine, const char *p_name);
 
 void engine_run(Engine *p_engine);
 
@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <fcntl.h>
 #include <assert.h>
 #include <unistd.h>
@@ -10,20 +11,33 @@
 #include <sys/types.h>
 #include "SDL2/SDL.h"
 
+#include "src/io/memory.h"
+#include "src/error/error.h"
+
+// tinyobj allocations live in the scratch arena for the duration of load_obj.
+static _Thread_local Arena *obj_arena = NULL;
+#define TINYOBJ_MALLOC(m_size) arena_alloc(obj_arena, m_size)
+#define TINYOBJ_CALLOC(m_count, m_size) arena_calloc(obj_arena, m_count, m_size)
+#define TINYOBJ_REALLOC_SIZED(m_ptr, m_old_size, m_new_size) arena_realloc(obj_arena, m_ptr, m_old_size, m_new_size)
+#define TINYOBJ_FREE(m_ptr) ((void)(m_ptr))
+
 #define TINYOBJ_LOADER_C_IMPLEMENTATION
 #include "thirdparty/tinyobj_loader_c/tinyobj_loader_c.h"
-#include "src/data_structures/hash_map.h"
+#include "src/data_structures/int_map.h"
 #include "src/vulkan/vk_renderer.h"
 
-#include "src/io/memory.h"
-#include "src/error/error.h"
-
 
 void get_resource_path(char r_dest[512], const char *p_file) {
     char *base_path = SDL_GetBasePath();
     snprintf(r_dest, 512, "%s%s", base_path, p_file);
 }
 
+void get_canonical_path(char r_dest[512], const char *p_path) {
+    char resolved[PATH_MAX];
+    const int length = snprintf(r_dest, 512, "%s", realpath(p_path, resolved) ? resolved : p_path);
+    ERR_FAIL_COND(length < 0 || length >= 512);
+}
+
 char *read_file(const char *p_path, size_t *r_file_size) {
     FILE *file = fopen(p_path, "rb");
     ERR_FAIL_COND_V(!file, NULL);
@@ -101,58 +115,83 @@ static void get_file_data(void* ctx, const char* filename, const int is_mtl,
   (*len) = data_len;
 }
 
-void load_obj(const char *p_path, Vector *r_vertexes, Vector *r_indexes) {
+void load_obj(const char *p_path, VertexVector *r_vertexes, U32Vector *r_indexes) {
     tinyobj_attrib_t attrib;
     tinyobj_shape_t* shapes = NULL;
     size_t num_shapes;
     tinyobj_material_t* materials = NULL;
     size_t num_materials;
 
+    ArenaScope scratch = arena_scratch_begin();
+    obj_arena = scratch.arena;
+
     unsigned int flags = TINYOBJ_FLAG_TRIANGULATE;
     int ret = tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials, &num_materials, p_path, get_file_data, NULL, flags);
     CRASH_COND_MSG(ret != TINYOBJ_SUCCESS, "FATAL: Failed to load model %s.", p_path);
 
-    HashMap *unique_vertices = hashmap_create(sizeof(uint32_t));
-    Vector vertexes = {0, 0, sizeof(Vertex), NULL};
-    Vector indices = {0, 0, sizeof(uint32_t), NULL};
+    // Dedup on the (v, vt, vn) index triple, packed as a mixed radix key.
+    // Missing attributes use the extra digit past the attribute count.
+    const uint64_t v_radix = (uint64_t)attrib.num_vertices + 1;
+    const uint64_t vt_radix = (uint64_t)attrib.num_texcoords + 1;
+    IntMap *unique_vertices = intmap_create();
+    intmap_reserve(unique_vertices, attrib.num_faces);
+
+    VertexVector vertexes = { 0 };
+    U32Vector indices = { 0 };
+    u32_vector_reserve(&indices, attrib.num_faces);
     for (u_int32_t i = 0; i < attrib.num_faces; i++) {
+        const tinyobj_vertex_index_t face = attrib.faces[i];
+        const uint64_t v_idx = face.v_idx >= 0 ? (uint64_t)face.v_idx : attrib.num_vertices;
+        const uint64_t vt_idx = face.vt_idx >= 0 ? (uint64_t)face.vt_idx : attrib.num_texcoords;
+        const uint64_t vn_idx = face.vn_idx >= 0 ? (uint64_t)face.vn_idx : attrib.num_normals;
+
+        bool inserted = false;
+        const uint32_t vertex_idx = vertexes.size;
+        const uint32_t *idx = intmap_get_or_insert(unique_vertices, v_idx + v_radix * (vt_idx + vt_radix * vn_idx), vertex_idx, &inserted);
+        u32_vector_push_back(&indices, *idx);
+        if (!inserted) {
+            continue;
+        }
+
         Vertex vertex = {
-            .pos = {
-                attrib.vertices[3 * attrib.faces[i].v_idx + 0],
-                attrib.vertices[3 * attrib.faces[i].v_idx + 1],
-                attrib.vertices[3 * attrib.faces[i].v_idx + 2],
-            },
-            .normal = {
-                attrib.normals[3 * attrib.faces[i].vn_idx + 0],
-                attrib.normals[3 * attrib.faces[i].vn_idx + 1],
-                attrib.normals[3 * attrib.faces[i].vn_idx + 2],
-            },
             .color = {
                 {1.0f},
                 {1.0f},
                 {1.0f},
                 {1.0f},
             },
-            .tex_coord = {
-                attrib.texcoords[2 * attrib.faces[i].vt_idx + 0],
-                1.0f - attrib.texcoords[2 * attrib.faces[i].vt_idx + 1]
-            }
         };
 
-        char key[128];
-        snprintf(key, 128, "%f%f%f%f%f%f%f%f%f", vertex.pos.x, vertex.pos.y, vertex.pos.z, vertex.color.r, vertex.color.g, vertex.color.b, vertex.color.a, vertex.tex_coord.x,vertex.tex_coord.y );
-        void *has = hashmap_get(unique_vertices, key, 128);
-        if (has) {
-            vector_push_back(&indices, &(*(uint32_t *)has));
-            continue;
+        if (face.v_idx >= 0) {
+            vertex.pos = (Vect3){
+                attrib.vertices[3 * face.v_idx + 0],
+                attrib.vertices[3 * face.v_idx + 1],
+                attrib.vertices[3 * face.v_idx + 2],
+            };
         }
 
-        hashmap_insert(unique_vertices, key, 128, &vertexes.size);
-        vector_push_back(&indices, &vertexes.size);
-        vector_push_back(&vertexes, &vertex);
+        if (face.vn_idx >= 0) {
+            vertex.normal = (Vect3){
+                attrib.normals[3 * face.vn_idx + 0],
+                attrib.normals[3 * face.vn_idx + 1],
+                attrib.normals[3 * face.vn_idx + 2],
+            };
+        }
+
+        if (face.vt_idx >= 0) {
+            vertex.tex_coord = (Vect2){
+                attrib.texcoords[2 * face.vt_idx + 0],
+                1.0f - attrib.texcoords[2 * face.vt_idx + 1]
+            };
+        }
+
+        vertex_vector_push_back(&vertexes, vertex);
     }
 
-    hashmap_free(unique_vertices);
+    intmap_free(unique_vertices);
+    arena_scratch_end(scratch);
+    obj_arena = NULL;
+
     *r_vertexes = vertexes;
     *r_indexes = indices;
 }
@@ -3,11 +3,15 @@
 
 #include <stddef.h>
 #include "src/data_structures/vector.h"
+#include "src/vulkan/vk_renderer.h"
 
 void get_resource_path(char r_dest[512], const char *p_file);
 
+// Resolves links and relative parts, p_path is copied as is when it can not be resolved.
+void get_canonical_path(char r_dest[512], const char *p_path);
+
 char *read_file(const char *p_path, size_t *r_file_size);
 
-void load_obj(const char *p_path, Vector *r_vertexes, Vector *r_indexes);
+void load_obj(const char *p_path, VertexVector *r_vertexes, U32Vector *r_indexes);
 
 #endif
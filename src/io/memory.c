@@ -1,9 +1,203 @@
+#define MEMORY_IMPLEMENTATION
 #include "memory.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "src/error/error.h"
 
+#define POOL_MIN_BLOCK_SHIFT 4
+#define POOL_CLASS_COUNT 7
+#define POOL_CHUNK_SIZE (64 * 1024)
+#define POOL_BATCH_BLOCKS 64
+
+#define ARENA_ALIGNMENT alignof(max_align_t)
+#define ARENA_SCRATCH_BLOCK_SIZE (1024 * 1024)
+
+#define MEMORY_MAX_SITES 4096
+#define MEMORY_DUMP_SITES 32
+
+#ifdef MEMORY_DEBUG
+
+// Prefixed to every allocation, padded to keep the returned pointer aligned.
+typedef struct AllocationHeader {
+    size_t size;
+    uint32_t site;
+    uint32_t magic;
+    alignas(max_align_t) unsigned char data[];
+} AllocationHeader;
+
+#define ALLOCATION_MAGIC 0x6d656d21
+#define POOL_ALLOCATION_MAGIC 0x706f6f6c
+
+typedef struct AllocationSite {
+    const char *file;
+    int line;
+    size_t live_bytes;
+    size_t live_allocations;
+    size_t total_bytes;
+    size_t total_allocations;
+} AllocationSite;
+
+static SDL_SpinLock memory_lock;
+static MemoryStats memory_stats;
+static AllocationSite memory_sites[MEMORY_MAX_SITES];
+static bool memory_atexit_registered = false;
+
+// Open addressing on (file, line). Each translation unit has its own copy of a header's __FILE__,
+// so names are hashed and compared by content. Called with memory_lock held.
+static uint32_t memory_site_index(const char *p_file, int p_line) {
+    uint32_t hash = 2166136261u;
+    for (const char *c = p_file; *c; c++) {
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+    }
+    hash = (hash ^ (uint32_t)p_line) * 16777619u;
+    uint32_t idx = (hash ^ (hash >> 16)) & (MEMORY_MAX_SITES - 1);
+    for (uint32_t i = 0; i < MEMORY_MAX_SITES; i++) {
+        AllocationSite *site = &memory_sites[idx];
+        if (site->file && site->line == p_line && (site->file == p_file || strcmp(site->file, p_file) == 0)) {
+            return idx;
+        }
+        if (!site->file) {
+            site->file = p_file;
+            site->line = p_line;
+            return idx;
+        }
+        idx = (idx + 1) & (MEMORY_MAX_SITES - 1);
+    }
+    // Table full, lump into the last probed site.
+    return idx;
+}
+
+static void memory_track(AllocationHeader *r_header, size_t p_size, uint32_t p_magic, const char *p_file, int p_line) {
+    SDL_AtomicLock(&memory_lock);
+    if (unlikely(!memory_atexit_registered)) {
+        memory_atexit_registered = true;
+        atexit(memory_dump_stats);
+    }
+
+    const uint32_t idx = memory_site_index(p_file, p_line);
+    AllocationSite *site = &memory_sites[idx];
+    site->live_bytes += p_size;
+    site->live_allocations++;
+    site->total_bytes += p_size;
+    site->total_allocations++;
+
+    memory_stats.live_bytes += p_size;
+    memory_stats.live_allocations++;
+    memory_stats.total_bytes += p_size;
+    memory_stats.total_allocations++;
+    if (memory_stats.live_bytes > memory_stats.peak_bytes) {
+        memory_stats.peak_bytes = memory_stats.live_bytes;
+    }
+    SDL_AtomicUnlock(&memory_lock);
+
+    r_header->size = p_size;
+    r_header->site = idx;
+    r_header->magic = p_magic;
+}
+
+static void memory_untrack(const AllocationHeader *p_header) {
+    SDL_AtomicLock(&memory_lock);
+    AllocationSite *site = &memory_sites[p_header->site];
+    site->live_bytes -= p_header->size;
+    site->live_allocations--;
+    memory_stats.live_bytes -= p_header->size;
+    memory_stats.live_allocations--;
+    SDL_AtomicUnlock(&memory_lock);
+}
+
+static AllocationHeader *memory_header(void *p_ptr, uint32_t p_magic) {
+    AllocationHeader *header = (AllocationHeader *)(void *)((unsigned char *)p_ptr - offsetof(AllocationHeader, data));
+    CRASH_COND_MSG(header->magic != p_magic, "FATAL: Pointer %p was not allocated with %s!", p_ptr, p_magic == ALLOCATION_MAGIC ? "mmalloc" : "pool_alloc");
+    return header;
+}
+
+void *_mmalloc_debug(size_t p_size, const char *p_file, int p_line) {
+    AllocationHeader *header = malloc(sizeof(AllocationHeader) + p_size);
+    CRASH_NULL_MSG(header, "%s", "Out of memory!");
+    memory_track(header, p_size, ALLOCATION_MAGIC, p_file, p_line);
+    return header->data;
+}
+
+void *_mrealloc_debug(void *p_ptr, size_t p_new_size, const char *p_file, int p_line) {
+    if (!p_ptr) {
+        return _mmalloc_debug(p_new_size, p_file, p_line);
+    }
+
+    AllocationHeader *header = memory_header(p_ptr, ALLOCATION_MAGIC);
+    memory_untrack(header);
+    header->magic = 0;
+
+    header = realloc(header, sizeof(AllocationHeader) + p_new_size);
+    CRASH_NULL_MSG(header, "%s", "Out of memory!");
+    memory_track(header, p_new_size, ALLOCATION_MAGIC, p_file, p_line);
+    return header->data;
+}
+
+void _mfree_debug(void *p_ptr) {
+    if (!p_ptr) {
+        return;
+    }
+
+    AllocationHeader *header = memory_header(p_ptr, ALLOCATION_MAGIC);
+    memory_untrack(header);
+    header->magic = 0;
+    free(header);
+}
+
+void *mmalloc(size_t p_size) {
+    return _mmalloc_debug(p_size, __FILE__, __LINE__);
+}
+
+void *mrealloc(void *p_ptr, size_t p_new_size) {
+    return _mrealloc_debug(p_ptr, p_new_size, __FILE__, __LINE__);
+}
+
+void mfree(void *p_ptr) {
+    _mfree_debug(p_ptr);
+}
+
+bool memory_get_stats(MemoryStats *r_stats) {
+    SDL_AtomicLock(&memory_lock);
+    *r_stats = memory_stats;
+    SDL_AtomicUnlock(&memory_lock);
+    return true;
+}
+
+static int memory_site_compare(const void *p_a, const void *p_b) {
+    const AllocationSite *a = p_a;
+    const AllocationSite *b = p_b;
+    if (a->total_bytes == b->total_bytes) {
+        return 0;
+    }
+    return a->total_bytes < b->total_bytes ? 1 : -1;
+}
+
+void memory_dump_stats(void) {
+    // Snapshot so the lock is not held while logging.
+    static AllocationSite sites[MEMORY_MAX_SITES];
+    MemoryStats stats;
+    SDL_AtomicLock(&memory_lock);
+    stats = memory_stats;
+    memcpy(sites, memory_sites, sizeof(sites));
+    SDL_AtomicUnlock(&memory_lock);
+
+    qsort(sites, MEMORY_MAX_SITES, sizeof(AllocationSite), memory_site_compare);
+
+    INFO_MSG("Memory: %zu bytes live in %zu allocations, peak %zu bytes, %zu bytes over %zu allocations total",
+        stats.live_bytes, stats.live_allocations, stats.peak_bytes, stats.total_bytes, stats.total_allocations);
+    for (size_t i = 0; i < MEMORY_DUMP_SITES && sites[i].file; i++) {
+        INFO_MSG("  %s:%i - %zu bytes live in %zu, %zu bytes over %zu total",
+            sites[i].file, sites[i].line, sites[i].live_bytes, sites[i].live_allocations, sites[i].total_bytes, sites[i].total_allocations);
+    }
+}
+
+#else
+
 void *mmalloc(size_t p_size) {
     void *ptr = malloc(p_size);
     CRASH_NULL_MSG(ptr, "%s", "Out of memory!");
@@ -19,3 +213,370 @@ void *mrealloc(void *p_ptr, size_t p_new_size) {
 void mfree(void *p_ptr) {
     free(p_ptr);
 }
+
+bool memory_get_stats(MemoryStats *r_stats) {
+    *r_stats = (MemoryStats){ 0 };
+    return false;
+}
+
+void memory_dump_stats(void) {
+    INFO_MSG("%s", "Memory stats are disabled, build with memory_debug=yes.");
+}
+
+#endif
+
+/// Pool
+
+// Blocks move between a thread's cache and the shared class in batches, so the class lock is taken
+// once per POOL_BATCH_BLOCKS allocations or frees instead of once per block.
+typedef struct PoolBlock {
+    struct PoolBlock *next;
+    struct PoolBlock *next_batch; // Only read on the first block of a batch in the shared class
+} PoolBlock;
+
+typedef struct PoolClass {
+    SDL_SpinLock lock;
+    PoolBlock *batches;
+} PoolClass;
+
+typedef struct PoolCache {
+    PoolBlock *free;
+    size_t count;
+} PoolCache;
+
+// Chunks are never returned, the pools only grow to the peak number of live blocks.
+static PoolClass pool_classes[POOL_CLASS_COUNT];
+static _Thread_local PoolCache pool_caches[POOL_CLASS_COUNT];
+
+static inline size_t pool_class_index(size_t p_size) {
+    size_t idx = 0;
+    while (((size_t)1 << (idx + POOL_MIN_BLOCK_SHIFT)) < p_size) {
+        idx++;
+    }
+    return idx;
+}
+
+// Links p_count blocks from p_first into one chain, returns its last block.
+static PoolBlock *pool_link_blocks(char *p_first, size_t p_count, size_t p_block_size) {
+    PoolBlock *block = (PoolBlock *)(void *)p_first;
+    for (size_t i = 1; i < p_count; i++) {
+        PoolBlock *next = (PoolBlock *)(void *)(p_first + (i * p_block_size));
+        block->next = next;
+        block = next;
+    }
+    block->next = NULL;
+    return block;
+}
+
+// Carves a new chunk into batches, the first one goes straight to the cache. The malloc happens
+// outside the class lock, which only covers pushing the other batches. Chunks are not tracked,
+// memory_debug builds track the blocks handed out instead so no byte is counted twice.
+static void pool_refill(PoolClass *r_pool_class, PoolCache *r_cache, size_t p_block_size) {
+    char *chunk = malloc(POOL_CHUNK_SIZE);
+    CRASH_NULL_MSG(chunk, "%s", "Out of memory!");
+    const size_t block_count = POOL_CHUNK_SIZE / p_block_size;
+
+    r_cache->count = SDL_min(block_count, POOL_BATCH_BLOCKS);
+    r_cache->free = (PoolBlock *)(void *)chunk;
+    pool_link_blocks(chunk, r_cache->count, p_block_size);
+
+    PoolBlock *first = NULL;
+    PoolBlock *last = NULL;
+    for (size_t i = r_cache->count; i < block_count; i += POOL_BATCH_BLOCKS) {
+        PoolBlock *batch = (PoolBlock *)(void *)(chunk + (i * p_block_size));
+        pool_link_blocks((char *)batch, SDL_min(block_count - i, POOL_BATCH_BLOCKS), p_block_size);
+        batch->next_batch = NULL;
+        if (last) {
+            last->next_batch = batch;
+        } else {
+            first = batch;
+        }
+        last = batch;
+    }
+    if (!first) {
+        return;
+    }
+
+    SDL_AtomicLock(&r_pool_class->lock);
+    last->next_batch = r_pool_class->batches;
+    r_pool_class->batches = first;
+    SDL_AtomicUnlock(&r_pool_class->lock);
+}
+
+static void *pool_alloc_block(size_t p_size) {
+    const size_t idx = pool_class_index(p_size);
+    PoolCache *cache = &pool_caches[idx];
+
+    if (unlikely(!cache->free)) {
+        PoolClass *pool_class = &pool_classes[idx];
+        SDL_AtomicLock(&pool_class->lock);
+        PoolBlock *batch = pool_class->batches;
+        if (batch) {
+            pool_class->batches = batch->next_batch;
+        }
+        SDL_AtomicUnlock(&pool_class->lock);
+
+        if (batch) {
+            // Batches freed by pool_thread_flush may be short, count this one
+            cache->free = batch;
+            cache->count = 0;
+            for (PoolBlock *block = batch; block; block = block->next) {
+                cache->count++;
+            }
+        } else {
+            pool_refill(pool_class, cache, (size_t)1 << (idx + POOL_MIN_BLOCK_SHIFT));
+        }
+    }
+
+    PoolBlock *block = cache->free;
+    cache->free = block->next;
+    cache->count--;
+    return block;
+}
+
+// Hands the first p_count blocks of the cache to the shared class as one batch.
+static void pool_flush_batch(PoolClass *r_pool_class, PoolCache *r_cache, size_t p_count) {
+    PoolBlock *batch = r_cache->free;
+    PoolBlock *last = batch;
+    for (size_t i = 1; i < p_count; i++) {
+        last = last->next;
+    }
+    r_cache->free = last->next;
+    r_cache->count -= p_count;
+    last->next = NULL;
+
+    SDL_AtomicLock(&r_pool_class->lock);
+    batch->next_batch = r_pool_class->batches;
+    r_pool_class->batches = batch;
+    SDL_AtomicUnlock(&r_pool_class->lock);
+}
+
+static void pool_free_block(void *p_ptr, size_t p_size) {
+    const size_t idx = pool_class_index(p_size);
+    PoolCache *cache = &pool_caches[idx];
+    PoolBlock *block = p_ptr;
+
+    block->next = cache->free;
+    cache->free = block;
+    cache->count++;
+
+    // Keep one batch for the next allocations, a thread that only frees hands the rest back
+    if (unlikely(cache->count >= POOL_BATCH_BLOCKS * 2)) {
+        pool_flush_batch(&pool_classes[idx], cache, POOL_BATCH_BLOCKS);
+    }
+}
+
+void pool_thread_flush(void) {
+    for (size_t i = 0; i < POOL_CLASS_COUNT; i++) {
+        if (pool_caches[i].count > 0) {
+            pool_flush_batch(&pool_classes[i], &pool_caches[i], pool_caches[i].count);
+        }
+    }
+}
+
+#ifdef MEMORY_DEBUG
+
+// Blocks carry the same header as mmalloc allocations, with their own magic so mixing up the frees crashes.
+void *_pool_alloc_debug(size_t p_size, const char *p_file, int p_line) {
+    const size_t block_size = sizeof(AllocationHeader) + p_size;
+    if (block_size > POOL_MAX_BLOCK_SIZE) {
+        return _mmalloc_debug(p_size, p_file, p_line);
+    }
+
+    AllocationHeader *header = pool_alloc_block(block_size);
+    memory_track(header, p_size, POOL_ALLOCATION_MAGIC, p_file, p_line);
+    return header->data;
+}
+
+void _pool_free_debug(void *p_ptr, size_t p_size) {
+    if (!p_ptr) {
+        return;
+    }
+
+    const size_t block_size = sizeof(AllocationHeader) + p_size;
+    if (block_size > POOL_MAX_BLOCK_SIZE) {
+        _mfree_debug(p_ptr);
+        return;
+    }
+
+    AllocationHeader *header = memory_header(p_ptr, POOL_ALLOCATION_MAGIC);
+    CRASH_COND_MSG(header->size != p_size, "FATAL: pool_free of %zu bytes for a block of %zu bytes!", p_size, header->size);
+    memory_untrack(header);
+    header->magic = 0;
+    pool_free_block(header, block_size);
+}
+
+void *pool_alloc(size_t p_size) {
+    return _pool_alloc_debug(p_size, __FILE__, __LINE__);
+}
+
+void pool_free(void *p_ptr, size_t p_size) {
+    _pool_free_debug(p_ptr, p_size);
+}
+
+#else
+
+void *pool_alloc(size_t p_size) {
+    if (p_size > POOL_MAX_BLOCK_SIZE) {
+        return mmalloc(p_size);
+    }
+    return pool_alloc_block(p_size);
+}
+
+void pool_free(void *p_ptr, size_t p_size) {
+    if (!p_ptr) {
+        return;
+    }
+
+    if (p_size > POOL_MAX_BLOCK_SIZE) {
+        mfree(p_ptr);
+        return;
+    }
+    pool_free_block(p_ptr, p_size);
+}
+
+#endif
+
+/// Arena
+
+struct ArenaBlock {
+    ArenaBlock *prev;
+    size_t capacity;
+    size_t used;
+    alignas(max_align_t) unsigned char data[];
+};
+
+static inline size_t arena_align(size_t p_size) {
+    return (p_size + (ARENA_ALIGNMENT - 1)) & ~(ARENA_ALIGNMENT - 1);
+}
+
+static void arena_push_block(Arena *r_arena, size_t p_min_capacity) {
+    size_t capacity = r_arena->block_size > p_min_capacity ? r_arena->block_size : p_min_capacity;
+    ArenaBlock *block = mmalloc(sizeof(ArenaBlock) + capacity);
+    block->prev = r_arena->block;
+    block->capacity = capacity;
+    block->used = 0;
+    r_arena->block = block;
+}
+
+static void arena_pop_blocks(Arena *r_arena, const ArenaBlock *p_until) {
+    while (r_arena->block != p_until) {
+        ArenaBlock *prev = r_arena->block->prev;
+        mfree(r_arena->block);
+        r_arena->block = prev;
+    }
+}
+
+void arena_init(Arena *r_arena, size_t p_block_size) {
+    r_arena->block = NULL;
+    r_arena->block_size = arena_align(p_block_size);
+    r_arena->used = 0;
+    r_arena->peak = 0;
+}
+
+void arena_free(Arena *r_arena) {
+    arena_pop_blocks(r_arena, NULL);
+    r_arena->used = 0;
+}
+
+void *arena_alloc(Arena *r_arena, size_t p_size) {
+    const size_t size = arena_align(p_size);
+    if (!r_arena->block || r_arena->block->used + size > r_arena->block->capacity) {
+        arena_push_block(r_arena, size);
+    }
+
+    void *ptr = r_arena->block->data + r_arena->block->used;
+    r_arena->block->used += size;
+    r_arena->used += size;
+    if (r_arena->used > r_arena->peak) {
+        r_arena->peak = r_arena->used;
+    }
+    return ptr;
+}
+
+void *arena_calloc(Arena *r_arena, size_t p_count, size_t p_size) {
+    void *ptr = arena_alloc(r_arena, p_count * p_size);
+    memset(ptr, 0, p_count * p_size);
+    return ptr;
+}
+
+void *arena_realloc(Arena *r_arena, void *p_ptr, size_t p_old_size, size_t p_new_size) {
+    if (!p_ptr) {
+        return arena_alloc(r_arena, p_new_size);
+    }
+
+    // Grow in place when it is the last allocation of the block.
+    ArenaBlock *block = r_arena->block;
+    const size_t old_size = arena_align(p_old_size);
+    const size_t new_size = arena_align(p_new_size);
+    if ((unsigned char *)p_ptr + old_size == block->data + block->used && block->used - old_size + new_size <= block->capacity) {
+        block->used = block->used - old_size + new_size;
+        r_arena->used = r_arena->used - old_size + new_size;
+        if (r_arena->used > r_arena->peak) {
+            r_arena->peak = r_arena->used;
+        }
+        return p_ptr;
+    }
+
+    if (p_new_size <= p_old_size) {
+        return p_ptr;
+    }
+
+    void *ptr = arena_alloc(r_arena, p_new_size);
+    memcpy(ptr, p_ptr, p_old_size);
+    return ptr;
+}
+
+void arena_reset(Arena *r_arena) {
+    // Fold overflow blocks into a single block that fits the peak.
+    if (r_arena->block && r_arena->block->prev) {
+        arena_pop_blocks(r_arena, NULL);
+        arena_push_block(r_arena, arena_align(r_arena->peak));
+    }
+
+    if (r_arena->block) {
+        r_arena->block->used = 0;
+    }
+    r_arena->used = 0;
+}
+
+ArenaMark arena_mark(const Arena *p_arena) {
+    return (ArenaMark){
+        .block = p_arena->block,
+        .block_used = p_arena->block ? p_arena->block->used : 0,
+        .used = p_arena->used,
+    };
+}
+
+void arena_rewind(Arena *r_arena, ArenaMark p_mark) {
+    // A mark taken before the first block keeps it, only overflow blocks go back to mmalloc
+    const ArenaBlock *until = p_mark.block;
+    if (!until && r_arena->block) {
+        until = r_arena->block;
+        while (until->prev) {
+            until = until->prev;
+        }
+    }
+    arena_pop_blocks(r_arena, until);
+    if (r_arena->block) {
+        r_arena->block->used = p_mark.block_used;
+    }
+    r_arena->used = p_mark.used;
+}
+
+static _Thread_local Arena scratch_arena = { NULL, ARENA_SCRATCH_BLOCK_SIZE, 0, 0 };
+
+ArenaScope arena_scratch_begin(void) {
+    return (ArenaScope){
+        .arena = &scratch_arena,
+        .mark = arena_mark(&scratch_arena),
+    };
+}
+
+void arena_scratch_end(ArenaScope p_scope) {
+    arena_rewind(p_scope.arena, p_scope.mark);
+}
+
+void arena_scratch_free(void) {
+    arena_free(&scratch_arena);
+}
@@ -2,6 +2,7 @@
 #define MEMORY_H_
 
 #include <stdlib.h>
+#include <stdbool.h>
 
 void *mmalloc(size_t p_size);
 
@@ -9,4 +10,114 @@ void *mrealloc(void *p_ptr, size_t p_new_size);
 
 void mfree(void *p_ptr);
 
+/// Instrumentation
+
+// Build with memory_debug=yes to track mmalloc, mrealloc and mfree per call site.
+typedef struct MemoryStats {
+    size_t live_bytes;
+    size_t live_allocations;
+    size_t peak_bytes;
+    size_t total_bytes;
+    size_t total_allocations;
+} MemoryStats;
+
+// Returns false when built without MEMORY_DEBUG.
+bool memory_get_stats(MemoryStats *r_stats);
+
+void memory_dump_stats(void);
+
+#ifdef MEMORY_DEBUG
+void *_mmalloc_debug(size_t p_size, const char *p_file, int p_line);
+void *_mrealloc_debug(void *p_ptr, size_t p_new_size, const char *p_file, int p_line);
+void _mfree_debug(void *p_ptr);
+
+#ifndef MEMORY_IMPLEMENTATION
+#define mmalloc(m_size) _mmalloc_debug(m_size, __FILE__, __LINE__)
+#define mrealloc(m_ptr, m_new_size) _mrealloc_debug(m_ptr, m_new_size, __FILE__, __LINE__)
+#define mfree(m_ptr) _mfree_debug(m_ptr)
+#endif
+#endif
+
+// Inline helpers that allocate for their caller take the caller's p_file and p_line, see VECTOR_DEFINE,
+// and reallocate on its behalf with mrealloc_site. Release builds ignore the site.
+#ifdef MEMORY_DEBUG
+#define mrealloc_site(m_ptr, m_new_size) _mrealloc_debug(m_ptr, m_new_size, p_file, p_line)
+#else
+#define mrealloc_site(m_ptr, m_new_size) ((void)p_file, (void)p_line, mrealloc(m_ptr, m_new_size))
+#endif
+
+/// Pool
+
+// Thread safe fixed block allocator for small objects, one free list per power of two size class.
+// Each thread caches blocks per class and trades them with the shared lists in batches, so most calls take no lock.
+// Sizes above POOL_MAX_BLOCK_SIZE fall through to mmalloc, p_size passed to pool_free must match pool_alloc.
+// memory_debug builds track each block like an mmalloc allocation and check the size passed to pool_free.
+#define POOL_MAX_BLOCK_SIZE 1024
+
+void *pool_alloc(size_t p_size);
+
+void pool_free(void *p_ptr, size_t p_size);
+
+// Returns the calling thread's cached blocks to the shared lists, call before the thread exits.
+void pool_thread_flush(void);
+
+#ifdef MEMORY_DEBUG
+void *_pool_alloc_debug(size_t p_size, const char *p_file, int p_line);
+void _pool_free_debug(void *p_ptr, size_t p_size);
+
+#ifndef MEMORY_IMPLEMENTATION
+#define pool_alloc(m_size) _pool_alloc_debug(m_size, __FILE__, __LINE__)
+#define pool_free(m_ptr, m_size) _pool_free_debug(m_ptr, m_size)
+#endif
+#endif
+
+/// Arena
+
+// Linear allocator, individual allocations are never freed, only reset or rewound as a whole.
+// Overflow chains extra blocks, reset folds them into one block sized to the peak so steady state use never mallocs.
+// Rewinding frees the overflow blocks past the mark but always keeps the first block.
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct Arena {
+    ArenaBlock *block;
+    size_t block_size;
+    size_t used;
+    size_t peak;
+} Arena;
+
+typedef struct ArenaMark {
+    ArenaBlock *block;
+    size_t block_used;
+    size_t used;
+} ArenaMark;
+
+void arena_init(Arena *r_arena, size_t p_block_size);
+
+void arena_free(Arena *r_arena);
+
+void *arena_alloc(Arena *r_arena, size_t p_size);
+
+void *arena_calloc(Arena *r_arena, size_t p_count, size_t p_size);
+
+void *arena_realloc(Arena *r_arena, void *p_ptr, size_t p_old_size, size_t p_new_size);
+
+void arena_reset(Arena *r_arena);
+
+ArenaMark arena_mark(const Arena *p_arena);
+
+void arena_rewind(Arena *r_arena, ArenaMark p_mark);
+
+// Per thread arena for temporary load time work, always pair with arena_scratch_end.
+typedef struct ArenaScope {
+    Arena *arena;
+    ArenaMark mark;
+} ArenaScope;
+
+ArenaScope arena_scratch_begin(void);
+
+void arena_scratch_end(ArenaScope p_scope);
+
+// Frees the calling thread's scratch arena, call before the thread exits.
+void arena_scratch_free(void);
+
 #endif
@@ -0,0 +1,270 @@
+#include "jobs.h"
+
+#include <SDL2/SDL.h>
+
+#include "src/error/error.h"
+#include "src/io/memory.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define JOB_DEQUE_MASK (JOB_DEQUE_CAPACITY - 1)
+#define JOB_PARALLEL_MAX_BATCHES 64
+#define JOB_STEAL_ATTEMPTS 4
+
+// top and bottom only grow, the slot is the position masked by the capacity.
+typedef struct JobDeque {
+    _Alignas(64) atomic_int_least64_t top;
+    _Alignas(64) atomic_int_least64_t bottom;
+    _Alignas(64) _Atomic(Job *) buffer[JOB_DEQUE_CAPACITY];
+} JobDeque;
+
+typedef struct JobThread {
+    SDL_Thread *thread;
+    JobDeque deque;
+    uint32_t index;
+    uint32_t random_state;
+} JobThread;
+
+// Index 0 is the thread that called job_system_init. Static so the deques keep their alignment.
+static JobThread job_threads[JOB_MAX_WORKERS + 1];
+
+static struct {
+    JobThread *threads;
+    uint32_t thread_count;
+    SDL_sem *wake;
+    atomic_bool running;
+} job_system = { job_threads, 0, NULL, false };
+
+static _Thread_local uint32_t job_thread = UINT32_MAX;
+
+/// Deque
+
+static bool job_deque_push(JobDeque *r_deque, Job *p_job) {
+    const int_least64_t bottom = atomic_load_explicit(&r_deque->bottom, memory_order_relaxed);
+    const int_least64_t top = atomic_load_explicit(&r_deque->top, memory_order_acquire);
+    if (bottom - top >= JOB_DEQUE_CAPACITY) {
+        return false;
+    }
+
+    atomic_store_explicit(&r_deque->buffer[bottom & JOB_DEQUE_MASK], p_job, memory_order_relaxed);
+    atomic_store_explicit(&r_deque->bottom, bottom + 1, memory_order_release);
+    return true;
+}
+
+// Owner only. Races stealers for the last job through top.
+static Job *job_deque_pop(JobDeque *r_deque) {
+    const int_least64_t bottom = atomic_load_explicit(&r_deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&r_deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int_least64_t top = atomic_load_explicit(&r_deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&r_deque->bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    Job *job = atomic_load_explicit(&r_deque->buffer[bottom & JOB_DEQUE_MASK], memory_order_relaxed);
+    if (top == bottom) {
+        if (!atomic_compare_exchange_strong_explicit(&r_deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) {
+            job = NULL;
+        }
+        atomic_store_explicit(&r_deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return job;
+}
+
+static Job *job_deque_steal(JobDeque *r_deque) {
+    int_least64_t top = atomic_load_explicit(&r_deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    const int_least64_t bottom = atomic_load_explicit(&r_deque->bottom, memory_order_acquire);
+    if (top >= bottom) {
+        return NULL;
+    }
+
+    Job *job = atomic_load_explicit(&r_deque->buffer[top & JOB_DEQUE_MASK], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&r_deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;
+    }
+    return job;
+}
+
+/// Scheduling
+
+static void job_run(Job *p_job) {
+    p_job->function(p_job->data);
+    atomic_fetch_sub_explicit(&p_job->counter->pending, 1, memory_order_release);
+}
+
+// Own deque first, then a few random victims.
+static Job *job_find(JobThread *r_thread) {
+    Job *job = job_deque_pop(&r_thread->deque);
+    if (job || job_system.thread_count < 2) {
+        return job;
+    }
+
+    for (uint32_t attempt = 0; attempt < JOB_STEAL_ATTEMPTS * job_system.thread_count; attempt++) {
+        // xorshift32
+        r_thread->random_state ^= r_thread->random_state << 13;
+        r_thread->random_state ^= r_thread->random_state >> 17;
+        r_thread->random_state ^= r_thread->random_state << 5;
+        const uint32_t victim = r_thread->random_state % job_system.thread_count;
+        if (victim == r_thread->index) {
+            continue;
+        }
+
+        job = job_deque_steal(&job_system.threads[victim].deque);
+        if (job) {
+            return job;
+        }
+    }
+    return NULL;
+}
+
+static inline void job_pause(void) {
+#if defined(__SSE2__)
+    _mm_pause();
+#endif
+}
+
+// Sleeps on the wake semaphore whenever nothing could be found, submits post it once per job.
+static int job_worker_run(void *p_thread) {
+    JobThread *thread = p_thread;
+    job_thread = thread->index;
+
+    while (atomic_load_explicit(&job_system.running, memory_order_acquire)) {
+        Job *job = job_find(thread);
+        if (job) {
+            job_run(job);
+        } else {
+            SDL_SemWait(job_system.wake);
+        }
+    }
+    arena_scratch_free();
+    pool_thread_flush();
+    return 0;
+}
+
+/// Interface
+
+void job_system_init(uint32_t p_worker_count) {
+    CRASH_COND_MSG(job_system.thread_count > 0, "%s", "FATAL: Job system already started!");
+
+    job_system.thread_count = SDL_min(p_worker_count, JOB_MAX_WORKERS) + 1;
+    job_system.wake = SDL_CreateSemaphore(0);
+    atomic_store(&job_system.running, true);
+
+    for (uint32_t i = 0; i < job_system.thread_count; i++) {
+        JobThread *thread = &job_system.threads[i];
+        atomic_init(&thread->deque.top, 0);
+        atomic_init(&thread->deque.bottom, 0);
+        thread->index = i;
+        thread->random_state = 0x9e3779b9u * (i + 1);
+        thread->thread = NULL;
+    }
+
+    job_thread = 0;
+    for (uint32_t i = 1; i < job_system.thread_count; i++) {
+        job_system.threads[i].thread = SDL_CreateThread(job_worker_run, "job_worker", &job_system.threads[i]);
+        CRASH_NULL_MSG(job_system.threads[i].thread, "%s", "FATAL: Failed to start job worker!");
+    }
+}
+
+void job_system_shutdown(void) {
+    ERR_FAIL_COND(job_system.thread_count == 0);
+
+    atomic_store(&job_system.running, false);
+    for (uint32_t i = 1; i < job_system.thread_count; i++) {
+        SDL_SemPost(job_system.wake);
+    }
+    for (uint32_t i = 1; i < job_system.thread_count; i++) {
+        SDL_WaitThread(job_system.threads[i].thread, NULL);
+    }
+
+    SDL_DestroySemaphore(job_system.wake);
+    job_system.thread_count = 0;
+    job_thread = UINT32_MAX;
+}
+
+uint32_t job_system_thread_count(void) {
+    return job_system.thread_count > 0 ? job_system.thread_count : 1;
+}
+
+uint32_t job_thread_index(void) {
+    return job_thread;
+}
+
+void jobs_submit(Job *r_jobs, size_t p_count, JobCounter *p_counter) {
+    atomic_fetch_add_explicit(&p_counter->pending, (int)p_count, memory_order_relaxed);
+
+    if (job_thread == UINT32_MAX || job_system.thread_count < 2) {
+        for (size_t i = 0; i < p_count; i++) {
+            r_jobs[i].counter = p_counter;
+            job_run(&r_jobs[i]);
+        }
+        return;
+    }
+
+    JobDeque *deque = &job_system.threads[job_thread].deque;
+    for (size_t i = 0; i < p_count; i++) {
+        r_jobs[i].counter = p_counter;
+        if (!job_deque_push(deque, &r_jobs[i])) {
+            job_run(&r_jobs[i]);
+        }
+    }
+
+    const size_t wake_count = SDL_min(p_count, (size_t)job_system.thread_count - 1);
+    for (size_t i = 0; i < wake_count; i++) {
+        SDL_SemPost(job_system.wake);
+    }
+}
+
+void jobs_wait(JobCounter *p_counter) {
+    while (atomic_load_explicit(&p_counter->pending, memory_order_acquire) > 0) {
+        Job *job = job_thread != UINT32_MAX ? job_find(&job_system.threads[job_thread]) : NULL;
+        if (job) {
+            job_run(job);
+        } else {
+            job_pause();
+        }
+    }
+}
+
+typedef struct ParallelForBatch {
+    ParallelForFunction function;
+    void *data;
+    size_t begin;
+    size_t end;
+} ParallelForBatch;
+
+static void parallel_for_batch(void *p_batch) {
+    const ParallelForBatch *batch = p_batch;
+    batch->function(batch->data, batch->begin, batch->end);
+}
+
+void parallel_for(size_t p_count, size_t p_min_batch, ParallelForFunction p_function, void *p_data) {
+    if (p_count == 0) {
+        return;
+    }
+
+    // A few batches per thread so stealing evens out uneven batches
+    const size_t min_batch = SDL_max(p_min_batch, (size_t)1);
+    size_t batch_count = SDL_min((p_count + min_batch - 1) / min_batch, (size_t)job_system_thread_count() * 4);
+    batch_count = SDL_min(batch_count, (size_t)JOB_PARALLEL_MAX_BATCHES);
+    if (batch_count < 2) {
+        p_function(p_data, 0, p_count);
+        return;
+    }
+
+    ParallelForBatch batches[JOB_PARALLEL_MAX_BATCHES];
+    Job jobs[JOB_PARALLEL_MAX_BATCHES];
+    for (size_t i = 0; i < batch_count; i++) {
+        batches[i] = (ParallelForBatch){ p_function, p_data, p_count * i / batch_count, p_count * (i + 1) / batch_count };
+        jobs[i] = (Job){ parallel_for_batch, &batches[i], NULL };
+    }
+
+    JobCounter counter = { 0 };
+    jobs_submit(jobs, batch_count, &counter);
+    jobs_wait(&counter);
+}
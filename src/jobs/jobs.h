@@ -0,0 +1,53 @@
+#ifndef JOBS_H_
+#define JOBS_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+// One worker thread per extra core, each owning a Chase-Lev deque. Owners push and pop at the
+// bottom, idle threads steal from the top of a random victim. The thread that called
+// job_system_init is thread 0 with its own deque, other threads run their jobs inline.
+#define JOB_MAX_WORKERS 15
+#define JOB_DEQUE_CAPACITY 4096 // Power of two, a push to a full deque runs the job inline
+
+typedef void (*JobFunction)(void *p_data);
+
+// Counts unfinished jobs, jobs_wait returns once it reaches zero. Zero initialise before use.
+typedef struct JobCounter {
+    atomic_int pending;
+} JobCounter;
+
+// Must stay alive until its counter is waited on.
+typedef struct Job {
+    JobFunction function;
+    void *data;
+    JobCounter *counter;
+} Job;
+
+// Starts p_worker_count threads, clamped to JOB_MAX_WORKERS. Zero runs everything on the caller.
+void job_system_init(uint32_t p_worker_count);
+
+// Every submitted job must have been waited on.
+void job_system_shutdown(void);
+
+// Workers plus the thread that called job_system_init.
+uint32_t job_system_thread_count(void);
+
+// 0 for the thread that called job_system_init, 1 and up for workers, UINT32_MAX for other threads.
+uint32_t job_thread_index(void);
+
+// Queues p_count jobs on the calling thread's deque, each decrementing p_counter when done.
+void jobs_submit(Job *r_jobs, size_t p_count, JobCounter *p_counter);
+
+// Runs queued jobs, its own or stolen, until p_counter reaches zero. Safe to call from inside a job.
+void jobs_wait(JobCounter *p_counter);
+
+typedef void (*ParallelForFunction)(void *p_data, size_t p_begin, size_t p_end);
+
+// Calls p_function over [0, p_count) in batches of at least p_min_batch across all threads and
+// returns once every batch ran. Batches are contiguous, so per range state like SIMD loops keeps working.
+void parallel_for(size_t p_count, size_t p_min_batch, ParallelForFunction p_function, void *p_data);
+
+#endif
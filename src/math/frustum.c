@@ -0,0 +1,136 @@
+#include "frustum.h"
+
+#include <math.h>
+#include <float.h>
+#include <string.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+Aabb aabb_from_points(const Vect3 *p_points, size_t p_count, size_t p_stride) {
+    if (p_count == 0) {
+        return (Aabb){ { 0, 0, 0 }, { 0, 0, 0 } };
+    }
+
+    Aabb aabb = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+    const char *point = (const char *)p_points;
+    for (size_t i = 0; i < p_count; i++, point += p_stride) {
+        Vect3 p;
+        memcpy(&p, point, sizeof(Vect3));
+        aabb.min.x = fminf(aabb.min.x, p.x);
+        aabb.min.y = fminf(aabb.min.y, p.y);
+        aabb.min.z = fminf(aabb.min.z, p.z);
+        aabb.max.x = fmaxf(aabb.max.x, p.x);
+        aabb.max.y = fmaxf(aabb.max.y, p.y);
+        aabb.max.z = fmaxf(aabb.max.z, p.z);
+    }
+    return aabb;
+}
+
+void aabb_transform(const Aabb *p_aabb, const Mat4 p_mat, Vect3 *r_center, Vect3 *r_extent) {
+    const Vect3 center = vect3_multi(vect3_add(p_aabb->min, p_aabb->max), 0.5f);
+    const Vect3 extent = vect3_multi(vect3_sub(p_aabb->max, p_aabb->min), 0.5f);
+
+    // Matrices are column major, p_mat[column][row]
+    r_center->x = p_mat[0][0] * center.x + p_mat[1][0] * center.y + p_mat[2][0] * center.z + p_mat[3][0];
+    r_center->y = p_mat[0][1] * center.x + p_mat[1][1] * center.y + p_mat[2][1] * center.z + p_mat[3][1];
+    r_center->z = p_mat[0][2] * center.x + p_mat[1][2] * center.y + p_mat[2][2] * center.z + p_mat[3][2];
+
+    r_extent->x = fabsf(p_mat[0][0]) * extent.x + fabsf(p_mat[1][0]) * extent.y + fabsf(p_mat[2][0]) * extent.z;
+    r_extent->y = fabsf(p_mat[0][1]) * extent.x + fabsf(p_mat[1][1]) * extent.y + fabsf(p_mat[2][1]) * extent.z;
+    r_extent->z = fabsf(p_mat[0][2]) * extent.x + fabsf(p_mat[1][2]) * extent.y + fabsf(p_mat[2][2]) * extent.z;
+}
+
+// Row p_row of the clip transform scaled by p_scale, plus p_w_scale times the w row, normalized.
+static Vect4 frustum_plane(const Mat4 p_mat, int p_row, float p_scale, float p_w_scale) {
+    Vect4 plane = {
+        .x = p_w_scale * p_mat[0][3] + p_scale * p_mat[0][p_row],
+        .y = p_w_scale * p_mat[1][3] + p_scale * p_mat[1][p_row],
+        .z = p_w_scale * p_mat[2][3] + p_scale * p_mat[2][p_row],
+        .w = p_w_scale * p_mat[3][3] + p_scale * p_mat[3][p_row],
+    };
+
+    const float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+    if (length > 0.0f) {
+        plane.x /= length;
+        plane.y /= length;
+        plane.z /= length;
+        plane.w /= length;
+    }
+    return plane;
+}
+
+void frustum_from_matrix(Frustum *r_frustum, const Mat4 p_view_proj) {
+    r_frustum->planes[0] = frustum_plane(p_view_proj, 0, 1.0f, 1.0f); // -w <= x
+    r_frustum->planes[1] = frustum_plane(p_view_proj, 0, -1.0f, 1.0f); // x <= w
+    r_frustum->planes[2] = frustum_plane(p_view_proj, 1, 1.0f, 1.0f); // -w <= y
+    r_frustum->planes[3] = frustum_plane(p_view_proj, 1, -1.0f, 1.0f); // y <= w
+    r_frustum->planes[4] = frustum_plane(p_view_proj, 2, 1.0f, 0.0f); // 0 <= z
+    r_frustum->planes[5] = frustum_plane(p_view_proj, 2, -1.0f, 1.0f); // z <= w
+}
+
+static uint8_t frustum_test_aabb(const Frustum *p_frustum, Vect3 p_center, Vect3 p_extent) {
+    for (int i = 0; i < 6; i++) {
+        const Vect4 plane = p_frustum->planes[i];
+        const float distance = plane.x * p_center.x + plane.y * p_center.y + plane.z * p_center.z + plane.w;
+        const float radius = fabsf(plane.x) * p_extent.x + fabsf(plane.y) * p_extent.y + fabsf(plane.z) * p_extent.z;
+        if (distance + radius < 0.0f) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void frustum_cull_aabbs(const Frustum *p_frustum, const AabbArrays *p_boxes, size_t p_count, uint8_t *r_visible) {
+    size_t i = 0;
+
+#if defined(__SSE__)
+    // Splat every plane once, each step then tests four boxes against all six
+    __m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+    __m128 abs_x[6], abs_y[6], abs_z[6];
+    for (int p = 0; p < 6; p++) {
+        const Vect4 plane = p_frustum->planes[p];
+        plane_x[p] = _mm_set1_ps(plane.x);
+        plane_y[p] = _mm_set1_ps(plane.y);
+        plane_z[p] = _mm_set1_ps(plane.z);
+        plane_w[p] = _mm_set1_ps(plane.w);
+        abs_x[p] = _mm_set1_ps(fabsf(plane.x));
+        abs_y[p] = _mm_set1_ps(fabsf(plane.y));
+        abs_z[p] = _mm_set1_ps(fabsf(plane.z));
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= p_count; i += 4) {
+        const __m128 center_x = _mm_loadu_ps(p_boxes->center_x + i);
+        const __m128 center_y = _mm_loadu_ps(p_boxes->center_y + i);
+        const __m128 center_z = _mm_loadu_ps(p_boxes->center_z + i);
+        const __m128 extent_x = _mm_loadu_ps(p_boxes->extent_x + i);
+        const __m128 extent_y = _mm_loadu_ps(p_boxes->extent_y + i);
+        const __m128 extent_z = _mm_loadu_ps(p_boxes->extent_z + i);
+
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+        for (int p = 0; p < 6; p++) {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(plane_x[p], center_x), plane_w[p]);
+            distance = _mm_add_ps(distance, _mm_mul_ps(plane_y[p], center_y));
+            distance = _mm_add_ps(distance, _mm_mul_ps(plane_z[p], center_z));
+            distance = _mm_add_ps(distance, _mm_mul_ps(abs_x[p], extent_x));
+            distance = _mm_add_ps(distance, _mm_mul_ps(abs_y[p], extent_y));
+            distance = _mm_add_ps(distance, _mm_mul_ps(abs_z[p], extent_z));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+        }
+
+        const int mask = _mm_movemask_ps(inside);
+        r_visible[i + 0] = (mask >> 0) & 1;
+        r_visible[i + 1] = (mask >> 1) & 1;
+        r_visible[i + 2] = (mask >> 2) & 1;
+        r_visible[i + 3] = (mask >> 3) & 1;
+    }
+#endif
+
+    for (; i < p_count; i++) {
+        r_visible[i] = frustum_test_aabb(p_frustum,
+            (Vect3){ p_boxes->center_x[i], p_boxes->center_y[i], p_boxes->center_z[i] },
+            (Vect3){ p_boxes->extent_x[i], p_boxes->extent_y[i], p_boxes->extent_z[i] });
+    }
+}
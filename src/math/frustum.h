@@ -0,0 +1,41 @@
+#ifndef FRUSTUM_H_
+#define FRUSTUM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vectors.h"
+#include "matrices.h"
+
+typedef struct Aabb {
+    Vect3 min;
+    Vect3 max;
+} Aabb;
+
+Aabb aabb_from_points(const Vect3 *p_points, size_t p_count, size_t p_stride);
+
+// Box enclosing p_aabb after p_mat, as a center and half extent.
+void aabb_transform(const Aabb *p_aabb, const Mat4 p_mat, Vect3 *r_center, Vect3 *r_extent);
+
+// Planes as (normal, distance) with the normal pointing inside, x * n + d >= 0 is in front.
+typedef struct Frustum {
+    Vect4 planes[6];
+} Frustum;
+
+// Extracts the planes of a Vulkan clip space (0 to w depth) projection * view matrix.
+void frustum_from_matrix(Frustum *r_frustum, const Mat4 p_view_proj);
+
+// Boxes as structure of arrays so four load into one register per component.
+typedef struct AabbArrays {
+    const float *center_x;
+    const float *center_y;
+    const float *center_z;
+    const float *extent_x;
+    const float *extent_y;
+    const float *extent_z;
+} AabbArrays;
+
+// Sets r_visible[i] to 1 when box i is at least partly inside, 0 otherwise. Four boxes per step with SSE.
+void frustum_cull_aabbs(const Frustum *p_frustum, const AabbArrays *p_boxes, size_t p_count, uint8_t *r_visible);
+
+#endif
@@ -98,3 +98,49 @@ void mat4_perspective(Mat4 r_mat, const float p_fov_y_radians, const float p_asp
     r_mat[2][3] = -1;
     r_mat[3][2] = -(2 * p_zfar * p_znear) / (p_zfar - p_znear);
 }
+
+void mat4_normal_matrix(const Mat4 p_mat, Mat3x4 r_normal) {
+    memset(r_normal, 0, sizeof(Mat3x4));
+
+    const Vect3 x = {p_mat[0][0], p_mat[0][1], p_mat[0][2]};
+    const Vect3 y = {p_mat[1][0], p_mat[1][1], p_mat[1][2]};
+    const Vect3 z = {p_mat[2][0], p_mat[2][1], p_mat[2][2]};
+
+    // Orthogonal columns of equal length, the upper 3x3 is its own inverse transpose up to scale
+    const float epsilon = 1e-5f;
+    const float length_x = x.x * x.x + x.y * x.y + x.z * x.z;
+    const float length_y = y.x * y.x + y.y * y.y + y.z * y.z;
+    const float length_z = z.x * z.x + z.y * z.y + z.z * z.z;
+    const float dot_xy = x.x * y.x + x.y * y.y + x.z * y.z;
+    const float dot_yz = y.x * z.x + y.y * z.y + y.z * z.z;
+    const float dot_zx = z.x * x.x + z.y * x.y + z.z * x.z;
+    if (fabsf(length_x - length_y) < epsilon * length_x && fabsf(length_x - length_z) < epsilon * length_x &&
+        fabsf(dot_xy) < epsilon * length_x && fabsf(dot_yz) < epsilon * length_x && fabsf(dot_zx) < epsilon * length_x) {
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                r_normal[i][j] = p_mat[i][j];
+            }
+        }
+        return;
+    }
+
+    // Cofactors of the upper 3x3 are its inverse transpose times the determinant
+    const Vect3 cofactor_x = {y.y * z.z - y.z * z.y, y.z * z.x - y.x * z.z, y.x * z.y - y.y * z.x};
+    const Vect3 cofactor_y = {z.y * x.z - z.z * x.y, z.z * x.x - z.x * x.z, z.x * x.y - z.y * x.x};
+    const Vect3 cofactor_z = {x.y * y.z - x.z * y.y, x.z * y.x - x.x * y.z, x.x * y.y - x.y * y.x};
+    const float determinant = x.x * cofactor_x.x + x.y * cofactor_x.y + x.z * cofactor_x.z;
+    if (fabsf(determinant) < 1e-12f) {
+        return;
+    }
+
+    const float inverse_determinant = 1.0f / determinant;
+    r_normal[0][0] = cofactor_x.x * inverse_determinant;
+    r_normal[0][1] = cofactor_x.y * inverse_determinant;
+    r_normal[0][2] = cofactor_x.z * inverse_determinant;
+    r_normal[1][0] = cofactor_y.x * inverse_determinant;
+    r_normal[1][1] = cofactor_y.y * inverse_determinant;
+    r_normal[1][2] = cofactor_y.z * inverse_determinant;
+    r_normal[2][0] = cofactor_z.x * inverse_determinant;
+    r_normal[2][1] = cofactor_z.y * inverse_determinant;
+    r_normal[2][2] = cofactor_z.z * inverse_determinant;
+}
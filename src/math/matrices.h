@@ -5,6 +5,9 @@
 
 typedef float Mat4[4][4];
 
+// A mat3 as three vec4 columns, how std140 and vertex inputs lay it out.
+typedef float Mat3x4[3][4];
+
 void mat4_multi(Mat4 r_mat, const Mat4 p_b);
 
 void mat4_rotate(Mat4 r_mat, const float p_radians, const Vect3 p_axis);
@@ -15,4 +18,8 @@ void mat4_look_at(Mat4 r_mat, const Vect3 p_camera_pos, const Vect3 p_position,
 
 void mat4_perspective(Mat4 r_mat, const float p_fov_y_radians, const float p_aspect, const float p_znear, const float p_zfar);
 
+// Inverse transpose of the upper 3x3, for transforming normals.
+// Rotations with uniform scale skip the inverse, shaders renormalize anyway.
+void mat4_normal_matrix(const Mat4 p_mat, Mat3x4 r_normal);
+
 #endif
@@ -0,0 +1,236 @@
+#include "meshlet.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "src/io/memory.h"
+
+// Cones whose normals spread further than this from the axis are never culled, too few views would cull them.
+#define MESHLET_MIN_CONE_DOT 0.1f
+
+size_t meshlet_bound(size_t p_index_count) {
+    // A meshlet is only closed once the next triangle does not fit, so it either has every triangle
+    // it can hold or at least MESHLET_MAX_VERTICES - 2 vertices, each with one index of its own.
+    const size_t by_triangles = (p_index_count / 3 + MESHLET_MAX_TRIANGLES - 1) / MESHLET_MAX_TRIANGLES;
+    const size_t by_vertices = (p_index_count + MESHLET_MAX_VERTICES - 3) / (MESHLET_MAX_VERTICES - 2);
+    return by_triangles > by_vertices ? by_triangles : by_vertices;
+}
+
+typedef struct MeshletBuilder {
+    const uint32_t *indices;
+
+    // Triangles around each vertex, the first live_counts[v] are not in a meshlet yet
+    const uint32_t *offsets;
+    uint32_t *adjacency;
+    uint32_t *live_counts;
+
+    // Vertices of the open meshlet have its id
+    uint32_t *stamps;
+    uint32_t id;
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+} MeshletBuilder;
+
+static uint32_t meshlet_new_vertices(const MeshletBuilder *p_builder, uint32_t p_triangle) {
+    const uint32_t *triangle = &p_builder->indices[p_triangle * 3];
+    return (p_builder->stamps[triangle[0]] != p_builder->id) + (p_builder->stamps[triangle[1]] != p_builder->id) + (p_builder->stamps[triangle[2]] != p_builder->id);
+}
+
+// Best live triangle around p_vertex that fits: fewest new vertices, then fewest live neighbours
+// so triangles that would be left stranded at the meshlet's edge are taken first.
+static void meshlet_find_candidate(const MeshletBuilder *p_builder, uint32_t p_vertex, uint32_t *r_best, uint32_t *r_best_score) {
+    for (uint32_t i = p_builder->offsets[p_vertex]; i < p_builder->offsets[p_vertex] + p_builder->live_counts[p_vertex]; i++) {
+        const uint32_t triangle = p_builder->adjacency[i];
+        const uint32_t new_vertices = meshlet_new_vertices(p_builder, triangle);
+        if (p_builder->vertex_count + new_vertices > MESHLET_MAX_VERTICES) {
+            continue;
+        }
+
+        const uint32_t *corners = &p_builder->indices[triangle * 3];
+        const uint32_t live = p_builder->live_counts[corners[0]] + p_builder->live_counts[corners[1]] + p_builder->live_counts[corners[2]];
+        const uint32_t score = (new_vertices << 24) | (live < 0xffffffu ? live : 0xffffffu);
+        if (score < *r_best_score) {
+            *r_best_score = score;
+            *r_best = triangle;
+        }
+    }
+}
+
+static void meshlet_remove_live(MeshletBuilder *r_builder, uint32_t p_vertex, uint32_t p_triangle) {
+    uint32_t *live = &r_builder->adjacency[r_builder->offsets[p_vertex]];
+    const uint32_t last = --r_builder->live_counts[p_vertex];
+    for (uint32_t i = 0; i <= last; i++) {
+        if (live[i] == p_triangle) {
+            live[i] = live[last];
+            live[last] = p_triangle;
+            return;
+        }
+    }
+}
+
+// Sphere around the vertices and the cone around the unit normals of the triangles in p_indices.
+static void meshlet_compute_bounds(Meshlet *r_meshlet, const Vect3 *p_positions, const uint32_t *p_indices) {
+    Vect3 min = p_positions[p_indices[0]];
+    Vect3 max = min;
+    for (uint32_t i = 1; i < r_meshlet->index_count; i++) {
+        const Vect3 position = p_positions[p_indices[i]];
+        min = (Vect3){ fminf(min.x, position.x), fminf(min.y, position.y), fminf(min.z, position.z) };
+        max = (Vect3){ fmaxf(max.x, position.x), fmaxf(max.y, position.y), fmaxf(max.z, position.z) };
+    }
+    r_meshlet->center = vect3_multi(vect3_add(min, max), 0.5f);
+    float radius_squared = 0.0f;
+    for (uint32_t i = 0; i < r_meshlet->index_count; i++) {
+        const Vect3 offset = vect3_sub(p_positions[p_indices[i]], r_meshlet->center);
+        radius_squared = fmaxf(radius_squared, vect3_dot(offset, offset));
+    }
+    r_meshlet->radius = sqrtf(radius_squared);
+
+    // Degenerate triangles face nowhere, they can not keep the meshlet from being culled
+    Vect3 normals[MESHLET_MAX_TRIANGLES];
+    uint32_t normal_count = 0;
+    Vect3 sum = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t i = 0; i < r_meshlet->index_count; i += 3) {
+        const Vect3 a = p_positions[p_indices[i]];
+        const Vect3 normal = vect3_cross(vect3_sub(p_positions[p_indices[i + 1]], a), vect3_sub(p_positions[p_indices[i + 2]], a));
+        const float length = sqrtf(vect3_dot(normal, normal));
+        if (length > 0.0f) {
+            normals[normal_count] = vect3_multi(normal, 1.0f / length);
+            sum = vect3_add(sum, normals[normal_count]);
+            normal_count++;
+        }
+    }
+
+    r_meshlet->cone_axis = (Vect3){ 0.0f, 0.0f, 0.0f };
+    r_meshlet->cone_cutoff = 1.0f;
+    const float sum_length = sqrtf(vect3_dot(sum, sum));
+    if (normal_count == 0 || sum_length <= 0.0f) {
+        return;
+    }
+
+    const Vect3 axis = vect3_multi(sum, 1.0f / sum_length);
+    float min_dot = 1.0f;
+    for (uint32_t i = 0; i < normal_count; i++) {
+        min_dot = fminf(min_dot, vect3_dot(axis, normals[i]));
+    }
+    if (min_dot <= MESHLET_MIN_CONE_DOT) {
+        return;
+    }
+    r_meshlet->cone_axis = axis;
+    r_meshlet->cone_cutoff = sqrtf(1.0f - min_dot * min_dot);
+}
+
+size_t mesh_build_meshlets(Meshlet *r_meshlets, uint32_t *r_indices, const uint32_t *p_indices, size_t p_index_count, const Vect3 *p_positions, size_t p_vertex_count, size_t p_stride) {
+    const size_t triangle_count = p_index_count / 3;
+    if (triangle_count == 0 || p_vertex_count == 0) {
+        return 0;
+    }
+
+    ArenaScope scratch = arena_scratch_begin();
+    Arena *arena = scratch.arena;
+
+    // Read from a copy, r_indices is written in meshlet order as meshlets close
+    uint32_t *indices = arena_alloc(arena, sizeof(uint32_t) * triangle_count * 3);
+    memcpy(indices, p_indices, sizeof(uint32_t) * triangle_count * 3);
+    Vect3 *positions = arena_alloc(arena, sizeof(Vect3) * p_vertex_count);
+    const char *point = (const char *)p_positions;
+    for (size_t i = 0; i < p_vertex_count; i++, point += p_stride) {
+        memcpy(&positions[i], point, sizeof(Vect3));
+    }
+
+    uint32_t *live_counts = arena_calloc(arena, p_vertex_count, sizeof(uint32_t));
+    for (size_t i = 0; i < triangle_count * 3; i++) {
+        live_counts[indices[i]]++;
+    }
+    uint32_t *offsets = arena_alloc(arena, sizeof(uint32_t) * (p_vertex_count + 1));
+    offsets[0] = 0;
+    for (size_t i = 0; i < p_vertex_count; i++) {
+        offsets[i + 1] = offsets[i] + live_counts[i];
+        live_counts[i] = 0;
+    }
+    uint32_t *adjacency = arena_alloc(arena, sizeof(uint32_t) * triangle_count * 3);
+    for (size_t i = 0; i < triangle_count * 3; i++) {
+        adjacency[offsets[indices[i]] + live_counts[indices[i]]++] = i / 3;
+    }
+
+    uint32_t *stamps = arena_alloc(arena, sizeof(uint32_t) * p_vertex_count);
+    memset(stamps, 0xff, sizeof(uint32_t) * p_vertex_count);
+    uint8_t *emitted = arena_calloc(arena, triangle_count, 1);
+
+    MeshletBuilder builder = {
+        .indices = indices,
+        .offsets = offsets,
+        .adjacency = adjacency,
+        .live_counts = live_counts,
+        .stamps = stamps,
+        .id = 0,
+        .vertex_count = 0,
+        .triangle_count = 0,
+    };
+
+    uint32_t vertices[MESHLET_MAX_VERTICES];
+    size_t meshlet_count = 0;
+    size_t index_count = 0;
+    size_t next_seed = 0;
+    uint32_t last = UINT32_MAX;
+    for (size_t emitted_count = 0; emitted_count < triangle_count;) {
+        // Grow from every vertex of the meshlet, a new one continues next to where the last one ended.
+        // Jump to the next triangle left in index order when nothing around the meshlet is left.
+        uint32_t best = UINT32_MAX;
+        uint32_t best_score = UINT32_MAX;
+        if (builder.triangle_count < MESHLET_MAX_TRIANGLES) {
+            for (int corner = 0; builder.vertex_count == 0 && last != UINT32_MAX && corner < 3; corner++) {
+                meshlet_find_candidate(&builder, indices[last * 3 + corner], &best, &best_score);
+            }
+            for (uint32_t i = 0; i < builder.vertex_count; i++) {
+                meshlet_find_candidate(&builder, vertices[i], &best, &best_score);
+            }
+        }
+        if (best == UINT32_MAX && builder.triangle_count < MESHLET_MAX_TRIANGLES) {
+            bool around = false;
+            for (uint32_t i = 0; !around && i < builder.vertex_count; i++) {
+                around = live_counts[vertices[i]] > 0;
+            }
+            while (!around && emitted[next_seed]) {
+                next_seed++;
+            }
+            if (!around && builder.vertex_count + meshlet_new_vertices(&builder, next_seed) <= MESHLET_MAX_VERTICES) {
+                best = next_seed;
+            }
+        }
+
+        if (best == UINT32_MAX) {
+            // Full, close it and start the next one from here
+            Meshlet *meshlet = &r_meshlets[meshlet_count++];
+            *meshlet = (Meshlet){ .first_index = index_count - builder.triangle_count * 3, .index_count = builder.triangle_count * 3 };
+            meshlet_compute_bounds(meshlet, positions, &r_indices[meshlet->first_index]);
+            builder.id++;
+            builder.vertex_count = 0;
+            builder.triangle_count = 0;
+            continue;
+        }
+
+        const uint32_t *corners = &indices[best * 3];
+        for (int corner = 0; corner < 3; corner++) {
+            if (stamps[corners[corner]] != builder.id) {
+                stamps[corners[corner]] = builder.id;
+                vertices[builder.vertex_count++] = corners[corner];
+            }
+            meshlet_remove_live(&builder, corners[corner], best);
+            r_indices[index_count++] = corners[corner];
+        }
+        emitted[best] = 1;
+        emitted_count++;
+        builder.triangle_count++;
+        last = best;
+    }
+
+    if (builder.triangle_count > 0) {
+        Meshlet *meshlet = &r_meshlets[meshlet_count++];
+        *meshlet = (Meshlet){ .first_index = index_count - builder.triangle_count * 3, .index_count = builder.triangle_count * 3 };
+        meshlet_compute_bounds(meshlet, positions, &r_indices[meshlet->first_index]);
+    }
+
+    arena_scratch_end(scratch);
+    return meshlet_count;
+}
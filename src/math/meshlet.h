@@ -0,0 +1,37 @@
+#ifndef MESHLET_H_
+#define MESHLET_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vectors.h"
+
+// Small enough for one workgroup to keep a meshlet's vertices on chip, should mesh shaders take over.
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// A cluster of neighbouring triangles, contiguous in the index list, with bounds to cull it on its own.
+// Matches the std430 layout of shaders/meshlet_cull_shader.comp.
+typedef struct Meshlet {
+    Vect3 center;
+    float radius;
+
+    // Every triangle faces away from a viewer at p with dot(center - p, cone_axis) >= cone_cutoff * |center - p| + radius.
+    // A cutoff of 1 never culls, the normals spread too far.
+    Vect3 cone_axis;
+    float cone_cutoff;
+
+    uint32_t first_index;
+    uint32_t index_count;
+    uint32_t padding[2];
+} Meshlet;
+
+// Most meshlets mesh_build_meshlets writes for p_index_count indices.
+size_t meshlet_bound(size_t p_index_count);
+
+// Groups the triangles of p_indices into meshlets of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES
+// triangles, growing each from the triangles sharing vertices with it. r_indices gets the same triangles reordered so
+// every meshlet is one range of them, first_index is relative to it. r_indices may be p_indices. Returns the meshlet count.
+size_t mesh_build_meshlets(Meshlet *r_meshlets, uint32_t *r_indices, const uint32_t *p_indices, size_t p_index_count, const Vect3 *p_positions, size_t p_vertex_count, size_t p_stride);
+
+#endif
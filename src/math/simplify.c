@@ -0,0 +1,380 @@
+#include "simplify.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "src/io/memory.h"
+#include "src/data_structures/radix_sort.h"
+
+// Vertices at one position, more than this and the position is never collapsed.
+#define SIMPLIFY_MAX_WEDGES 16
+
+// Weight of the planes through open border edges, relative to the face planes.
+#define SIMPLIFY_BORDER_WEIGHT 10.0
+
+/// Quadric
+
+// Sum of weighted squared distances to planes, a symmetric 4x4 matrix.
+typedef struct Quadric {
+    double a00, a11, a22, a01, a02, a12;
+    double b0, b1, b2;
+    double c;
+    double weight;
+} Quadric;
+
+static void quadric_add_plane(Quadric *r_quadric, Vect3 p_normal, float p_distance, double p_weight) {
+    const double x = p_normal.x, y = p_normal.y, z = p_normal.z, d = p_distance;
+    r_quadric->a00 += p_weight * x * x;
+    r_quadric->a11 += p_weight * y * y;
+    r_quadric->a22 += p_weight * z * z;
+    r_quadric->a01 += p_weight * x * y;
+    r_quadric->a02 += p_weight * x * z;
+    r_quadric->a12 += p_weight * y * z;
+    r_quadric->b0 += p_weight * x * d;
+    r_quadric->b1 += p_weight * y * d;
+    r_quadric->b2 += p_weight * z * d;
+    r_quadric->c += p_weight * d * d;
+    r_quadric->weight += p_weight;
+}
+
+static void quadric_add(Quadric *r_quadric, const Quadric *p_other) {
+    r_quadric->a00 += p_other->a00;
+    r_quadric->a11 += p_other->a11;
+    r_quadric->a22 += p_other->a22;
+    r_quadric->a01 += p_other->a01;
+    r_quadric->a02 += p_other->a02;
+    r_quadric->a12 += p_other->a12;
+    r_quadric->b0 += p_other->b0;
+    r_quadric->b1 += p_other->b1;
+    r_quadric->b2 += p_other->b2;
+    r_quadric->c += p_other->c;
+    r_quadric->weight += p_other->weight;
+}
+
+// Weighted mean of the squared plane distances of p_point.
+static float quadric_error(const Quadric *p_a, const Quadric *p_b, Vect3 p_point) {
+    const double weight = p_a->weight + p_b->weight;
+    if (weight <= 0.0) {
+        return 0.0f;
+    }
+
+    const double x = p_point.x, y = p_point.y, z = p_point.z;
+    const double a00 = p_a->a00 + p_b->a00, a11 = p_a->a11 + p_b->a11, a22 = p_a->a22 + p_b->a22;
+    const double a01 = p_a->a01 + p_b->a01, a02 = p_a->a02 + p_b->a02, a12 = p_a->a12 + p_b->a12;
+    const double b0 = p_a->b0 + p_b->b0, b1 = p_a->b1 + p_b->b1, b2 = p_a->b2 + p_b->b2;
+    const double error = x * (a00 * x + a01 * y + a02 * z) + y * (a01 * x + a11 * y + a12 * z) + z * (a02 * x + a12 * y + a22 * z)
+        + 2.0 * (b0 * x + b1 * y + b2 * z) + p_a->c + p_b->c;
+    return error > 0.0 ? (float)(error / weight) : 0.0f;
+}
+
+/// Simplify
+
+typedef struct SimplifyVertex {
+    Vect3 position;
+    uint32_t vertex;
+} SimplifyVertex;
+
+static int simplify_vertex_compare(const void *p_a, const void *p_b) {
+    const SimplifyVertex *a = p_a;
+    const SimplifyVertex *b = p_b;
+    const int order = memcmp(&a->position, &b->position, sizeof(Vect3));
+    return order != 0 ? order : (a->vertex > b->vertex) - (a->vertex < b->vertex);
+}
+
+typedef struct Simplifier {
+    const Vect3 *positions; // Per position id
+    const uint32_t *position_ids; // Per vertex
+    const uint32_t *triangle_offsets; // Triangles around each position id, rebuilt every pass
+    const uint32_t *triangles;
+    const uint32_t *indices;
+} Simplifier;
+
+static Vect3 triangle_normal(Vect3 p_a, Vect3 p_b, Vect3 p_c) {
+    return vect3_cross(vect3_sub(p_b, p_a), vect3_sub(p_c, p_a));
+}
+
+// Pairs every vertex at p_from with the vertex at p_to it becomes, one per side of the collapsed
+// edge. Fails when a vertex at p_from is not on the edge, it would have no match, or when a
+// triangle around p_from would flip. Returns the number of triangles removed or -1.
+static int simplify_check_collapse(const Simplifier *p_simplifier, uint32_t p_from, uint32_t p_to, uint32_t r_pairs[SIMPLIFY_MAX_WEDGES][2], uint32_t *r_pair_count) {
+    const uint32_t *ids = p_simplifier->position_ids;
+    *r_pair_count = 0;
+    int removed = 0;
+
+    // Triangles on the edge give the pairs
+    for (uint32_t t = p_simplifier->triangle_offsets[p_from]; t < p_simplifier->triangle_offsets[p_from + 1]; t++) {
+        const uint32_t *triangle = &p_simplifier->indices[p_simplifier->triangles[t] * 3];
+        uint32_t from_vertex = UINT32_MAX, to_vertex = UINT32_MAX;
+        for (int corner = 0; corner < 3; corner++) {
+            if (ids[triangle[corner]] == p_from) {
+                from_vertex = triangle[corner];
+            } else if (ids[triangle[corner]] == p_to) {
+                to_vertex = triangle[corner];
+            }
+        }
+        if (to_vertex == UINT32_MAX) {
+            continue;
+        }
+        removed++;
+
+        uint32_t pair = 0;
+        while (pair < *r_pair_count && r_pairs[pair][0] != from_vertex) {
+            pair++;
+        }
+        if (pair == *r_pair_count) {
+            if (pair == SIMPLIFY_MAX_WEDGES) {
+                return -1;
+            }
+            r_pairs[pair][0] = from_vertex;
+            r_pairs[pair][1] = to_vertex;
+            (*r_pair_count)++;
+        } else if (r_pairs[pair][1] != to_vertex) {
+            return -1;
+        }
+    }
+
+    // The rest move to p_to, they must keep their facing
+    for (uint32_t t = p_simplifier->triangle_offsets[p_from]; t < p_simplifier->triangle_offsets[p_from + 1]; t++) {
+        const uint32_t *triangle = &p_simplifier->indices[p_simplifier->triangles[t] * 3];
+        const uint32_t a = ids[triangle[0]], b = ids[triangle[1]], c = ids[triangle[2]];
+        if (a == p_to || b == p_to || c == p_to) {
+            continue;
+        }
+
+        const uint32_t from_vertex = a == p_from ? triangle[0] : (b == p_from ? triangle[1] : triangle[2]);
+        uint32_t pair = 0;
+        while (pair < *r_pair_count && r_pairs[pair][0] != from_vertex) {
+            pair++;
+        }
+        if (pair == *r_pair_count) {
+            return -1;
+        }
+
+        const Vect3 *positions = p_simplifier->positions;
+        const Vect3 before = triangle_normal(positions[a], positions[b], positions[c]);
+        const Vect3 after = triangle_normal(positions[a == p_from ? p_to : a], positions[b == p_from ? p_to : b], positions[c == p_from ? p_to : c]);
+        if (vect3_dot(before, after) <= 0.0f) {
+            return -1;
+        }
+    }
+    return removed;
+}
+
+size_t mesh_simplify(uint32_t *r_indices, const uint32_t *p_indices, size_t p_index_count, const Vect3 *p_positions, size_t p_vertex_count, size_t p_stride,
+    size_t p_target_index_count, float p_max_error, float *r_error) {
+    if (r_indices != p_indices) {
+        memcpy(r_indices, p_indices, sizeof(uint32_t) * p_index_count);
+    }
+    *r_error = 0.0f;
+    size_t index_count = p_index_count - p_index_count % 3;
+    if (index_count <= p_target_index_count || p_vertex_count == 0) {
+        return index_count;
+    }
+
+    ArenaScope scratch = arena_scratch_begin();
+    Arena *arena = scratch.arena;
+
+    // Vertices split only by attributes share a position id
+    SimplifyVertex *sorted = arena_alloc(arena, sizeof(SimplifyVertex) * p_vertex_count);
+    const char *point = (const char *)p_positions;
+    for (size_t i = 0; i < p_vertex_count; i++, point += p_stride) {
+        memcpy(&sorted[i].position, point, sizeof(Vect3));
+        sorted[i].vertex = i;
+    }
+    qsort(sorted, p_vertex_count, sizeof(SimplifyVertex), simplify_vertex_compare);
+
+    uint32_t *position_ids = arena_alloc(arena, sizeof(uint32_t) * p_vertex_count);
+    Vect3 *positions = arena_alloc(arena, sizeof(Vect3) * p_vertex_count);
+    uint32_t position_count = 0;
+    for (size_t i = 0; i < p_vertex_count; i++) {
+        if (i == 0 || memcmp(&sorted[i].position, &sorted[i - 1].position, sizeof(Vect3)) != 0) {
+            positions[position_count++] = sorted[i].position;
+        }
+        position_ids[sorted[i].vertex] = position_count - 1;
+    }
+
+    // Planes of the faces around each position, weighted by area
+    Quadric *quadrics = arena_calloc(arena, position_count, sizeof(Quadric));
+    for (size_t i = 0; i < index_count; i += 3) {
+        const uint32_t ids[3] = { position_ids[r_indices[i]], position_ids[r_indices[i + 1]], position_ids[r_indices[i + 2]] };
+        const Vect3 normal = triangle_normal(positions[ids[0]], positions[ids[1]], positions[ids[2]]);
+        const float length = sqrtf(vect3_dot(normal, normal));
+        if (length <= 0.0f) {
+            continue;
+        }
+        const Vect3 unit = vect3_multi(normal, 1.0f / length);
+        for (int corner = 0; corner < 3; corner++) {
+            quadric_add_plane(&quadrics[ids[corner]], unit, -vect3_dot(unit, positions[ids[0]]), length * 0.5);
+        }
+    }
+
+    // Edges used once are open borders, planes through them along the face keep them in place
+    const size_t edge_count = index_count;
+    uint64_t *edge_keys = arena_alloc(arena, sizeof(uint64_t) * edge_count);
+    uint32_t *edge_corners = arena_alloc(arena, sizeof(uint32_t) * edge_count);
+    for (size_t i = 0; i < index_count; i++) {
+        const uint32_t a = position_ids[r_indices[i]];
+        const uint32_t b = position_ids[r_indices[i - i % 3 + (i + 1) % 3]];
+        edge_keys[i] = a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a;
+        edge_corners[i] = i;
+    }
+    radix_sort_u64(edge_keys, edge_corners, arena_alloc(arena, sizeof(uint64_t) * edge_count), arena_alloc(arena, sizeof(uint32_t) * edge_count), edge_count);
+    for (size_t i = 0; i < edge_count; i++) {
+        if ((i > 0 && edge_keys[i - 1] == edge_keys[i]) || (i + 1 < edge_count && edge_keys[i + 1] == edge_keys[i])) {
+            continue;
+        }
+
+        const uint32_t corner = edge_corners[i];
+        const uint32_t triangle = corner - corner % 3;
+        const uint32_t a = position_ids[r_indices[corner]];
+        const uint32_t b = position_ids[r_indices[triangle + (corner + 1) % 3]];
+        const Vect3 face = triangle_normal(positions[position_ids[r_indices[triangle]]], positions[position_ids[r_indices[triangle + 1]]], positions[position_ids[r_indices[triangle + 2]]]);
+        const Vect3 edge = vect3_sub(positions[b], positions[a]);
+        const Vect3 normal = vect3_cross(edge, face);
+        const float length = sqrtf(vect3_dot(normal, normal));
+        if (length <= 0.0f) {
+            continue;
+        }
+        const Vect3 unit = vect3_multi(normal, 1.0f / length);
+        const double weight = vect3_dot(edge, edge) * SIMPLIFY_BORDER_WEIGHT;
+        quadric_add_plane(&quadrics[a], unit, -vect3_dot(unit, positions[a]), weight);
+        quadric_add_plane(&quadrics[b], unit, -vect3_dot(unit, positions[a]), weight);
+    }
+
+    uint32_t *remap = arena_alloc(arena, sizeof(uint32_t) * p_vertex_count);
+    uint8_t *touched = arena_alloc(arena, position_count);
+    uint32_t *triangle_offsets = arena_alloc(arena, sizeof(uint32_t) * (position_count + 1));
+    const float max_cost = p_max_error * p_max_error;
+    float max_collapse_cost = 0.0f;
+
+    // Passes of independent collapses, the adjacency is rebuilt between them
+    while (index_count > p_target_index_count) {
+        const ArenaMark pass_mark = arena_mark(arena);
+        const size_t triangle_count = index_count / 3;
+
+        memset(triangle_offsets, 0, sizeof(uint32_t) * (position_count + 1));
+        for (size_t i = 0; i < index_count; i++) {
+            triangle_offsets[position_ids[r_indices[i]] + 1]++;
+        }
+        for (uint32_t i = 0; i < position_count; i++) {
+            triangle_offsets[i + 1] += triangle_offsets[i];
+        }
+        uint32_t *triangles = arena_alloc(arena, sizeof(uint32_t) * index_count);
+        uint32_t *fill = arena_alloc(arena, sizeof(uint32_t) * position_count);
+        memcpy(fill, triangle_offsets, sizeof(uint32_t) * position_count);
+        for (size_t i = 0; i < index_count; i++) {
+            triangles[fill[position_ids[r_indices[i]]]++] = i / 3;
+        }
+
+        // Cheaper direction of every edge, keyed by cost. Costs are positive so their bits sort as integers.
+        for (size_t i = 0; i < index_count; i++) {
+            const uint32_t a = position_ids[r_indices[i]];
+            const uint32_t b = position_ids[r_indices[i - i % 3 + (i + 1) % 3]];
+            edge_keys[i] = a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a;
+        }
+        uint64_t *sort_keys = arena_alloc(arena, sizeof(uint64_t) * index_count);
+        radix_sort_u64(edge_keys, edge_corners, sort_keys, arena_alloc(arena, sizeof(uint32_t) * index_count), index_count);
+
+        uint32_t (*collapses)[2] = arena_alloc(arena, sizeof(uint32_t[2]) * index_count);
+        uint64_t *cost_keys = sort_keys;
+        uint32_t *cost_order = arena_alloc(arena, sizeof(uint32_t) * index_count);
+        size_t collapse_count = 0;
+        for (size_t i = 0; i < index_count; i++) {
+            if (i > 0 && edge_keys[i - 1] == edge_keys[i]) {
+                continue;
+            }
+            const uint32_t a = edge_keys[i] >> 32;
+            const uint32_t b = edge_keys[i] & UINT32_MAX;
+            if (a == b) {
+                continue;
+            }
+
+            const float cost_ab = quadric_error(&quadrics[a], &quadrics[b], positions[b]);
+            const float cost_ba = quadric_error(&quadrics[a], &quadrics[b], positions[a]);
+            const float cost = fminf(cost_ab, cost_ba);
+            uint32_t bits;
+            memcpy(&bits, &cost, sizeof(uint32_t));
+            collapses[collapse_count][0] = cost_ab <= cost_ba ? a : b;
+            collapses[collapse_count][1] = cost_ab <= cost_ba ? b : a;
+            cost_keys[collapse_count] = bits;
+            cost_order[collapse_count] = collapse_count;
+            collapse_count++;
+        }
+        radix_sort_u64(cost_keys, cost_order, arena_alloc(arena, sizeof(uint64_t) * collapse_count), arena_alloc(arena, sizeof(uint32_t) * collapse_count), collapse_count);
+
+        const Simplifier simplifier = {
+            .positions = positions,
+            .position_ids = position_ids,
+            .triangle_offsets = triangle_offsets,
+            .triangles = triangles,
+            .indices = r_indices,
+        };
+        for (size_t i = 0; i < p_vertex_count; i++) {
+            remap[i] = i;
+        }
+        memset(touched, 0, position_count);
+
+        // Cheapest first, positions around a collapse wait for the next pass
+        size_t remaining = index_count;
+        size_t collapsed = 0;
+        for (size_t i = 0; i < collapse_count && remaining > p_target_index_count; i++) {
+            float cost;
+            const uint32_t bits = cost_keys[i];
+            memcpy(&cost, &bits, sizeof(float));
+            if (cost > max_cost) {
+                break;
+            }
+
+            const uint32_t from = collapses[cost_order[i]][0];
+            const uint32_t to = collapses[cost_order[i]][1];
+            if (touched[from] || touched[to]) {
+                continue;
+            }
+
+            uint32_t pairs[SIMPLIFY_MAX_WEDGES][2];
+            uint32_t pair_count;
+            const int removed = simplify_check_collapse(&simplifier, from, to, pairs, &pair_count);
+            if (removed < 0) {
+                continue;
+            }
+
+            for (uint32_t pair = 0; pair < pair_count; pair++) {
+                remap[pairs[pair][0]] = pairs[pair][1];
+            }
+            quadric_add(&quadrics[to], &quadrics[from]);
+            for (uint32_t t = triangle_offsets[from]; t < triangle_offsets[from + 1]; t++) {
+                const uint32_t *triangle = &r_indices[triangles[t] * 3];
+                touched[position_ids[triangle[0]]] = 1;
+                touched[position_ids[triangle[1]]] = 1;
+                touched[position_ids[triangle[2]]] = 1;
+            }
+            max_collapse_cost = fmaxf(max_collapse_cost, cost);
+            remaining -= (size_t)removed * 3;
+            collapsed++;
+        }
+
+        // Triangles that lost a corner are dropped
+        size_t write = 0;
+        for (size_t i = 0; i < triangle_count && collapsed > 0; i++) {
+            const uint32_t a = remap[r_indices[i * 3]], b = remap[r_indices[i * 3 + 1]], c = remap[r_indices[i * 3 + 2]];
+            if (position_ids[a] == position_ids[b] || position_ids[b] == position_ids[c] || position_ids[a] == position_ids[c]) {
+                continue;
+            }
+            r_indices[write++] = a;
+            r_indices[write++] = b;
+            r_indices[write++] = c;
+        }
+
+        arena_rewind(arena, pass_mark);
+        if (collapsed == 0) {
+            break;
+        }
+        index_count = write;
+    }
+
+    arena_scratch_end(scratch);
+    *r_error = sqrtf(max_collapse_cost);
+    return index_count;
+}
@@ -0,0 +1,18 @@
+#ifndef SIMPLIFY_H_
+#define SIMPLIFY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vectors.h"
+
+// Collapses edges of a triangle list, least quadric error first, until p_target_index_count indices
+// are left or the next collapse would move the surface by more than p_max_error. Vertices are never
+// moved or added, the result indexes the same vertex array so every level can share one vertex buffer.
+// Vertices sharing a position but not attributes only collapse along their seam, open borders are kept
+// by extra planes. r_indices may be p_indices. Returns the new index count, r_error gets the largest
+// error of a collapse done, an approximate distance in the units of the positions.
+size_t mesh_simplify(uint32_t *r_indices, const uint32_t *p_indices, size_t p_index_count, const Vect3 *p_positions, size_t p_vertex_count, size_t p_stride,
+    size_t p_target_index_count, float p_max_error, float *r_error);
+
+#endif
@@ -1,9 +1,11 @@
 #ifndef OBJECT_H_
 #define OBJECT_H_
 
-#include "src/data_structures/vector.h"
+#include "src/data_structures/slot_map.h"
 #include "src/vulkan/vk_renderer.h"
 
+typedef SlotHandle ObjectHandle;
+
 typedef struct Object {
     Vect3 position;
     Vect3 rotation;
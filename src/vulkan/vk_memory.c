@@ -0,0 +1,511 @@
+#include "vk_memory.h"
+
+#include <string.h>
+
+#include "src/io/memory.h"
+#include "src/error/error.h"
+
+#define GPU_MEMORY_TOP_ORDER (GPU_MEMORY_ORDERS - 1)
+#define GPU_MEMORY_NODE_COUNT ((1u << GPU_MEMORY_ORDERS) - 1)
+
+/// Buddy block
+
+static inline VkDeviceSize gpu_order_size(uint32_t p_order) {
+    return GPU_MEMORY_MIN_SIZE << p_order;
+}
+
+// Orders are packed top down, the top order has one node and every order below doubles it.
+static inline uint32_t gpu_node_bit(uint32_t p_order, uint32_t p_node) {
+    const uint32_t order_nodes = 1u << (GPU_MEMORY_TOP_ORDER - p_order);
+    return (GPU_MEMORY_NODE_COUNT - ((order_nodes << 1) - 1)) + p_node;
+}
+
+static inline bool gpu_node_is_free(const GpuMemoryBlock *p_block, uint32_t p_order, uint32_t p_node) {
+    const uint32_t bit = gpu_node_bit(p_order, p_node);
+    return p_block->free_bits[bit >> 3] & (1u << (bit & 7));
+}
+
+static inline void gpu_node_set_free(GpuMemoryBlock *r_block, uint32_t p_order, uint32_t p_node, bool p_free) {
+    const uint32_t bit = gpu_node_bit(p_order, p_node);
+    if (p_free) {
+        r_block->free_bits[bit >> 3] |= (uint8_t)(1u << (bit & 7));
+    } else {
+        r_block->free_bits[bit >> 3] &= (uint8_t)~(1u << (bit & 7));
+    }
+}
+
+static void gpu_block_compact(GpuMemoryBlock *r_block, uint32_t p_order) {
+    // Drop stale and duplicate entries, clearing the bit on first sight catches duplicates.
+    U32Vector *list = &r_block->free_lists[p_order];
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < list->size; i++) {
+        const uint32_t node = list->data[i];
+        if (gpu_node_is_free(r_block, p_order, node)) {
+            gpu_node_set_free(r_block, p_order, node, false);
+            list->data[kept++] = node;
+        }
+    }
+    list->size = kept;
+    for (uint32_t i = 0; i < kept; i++) {
+        gpu_node_set_free(r_block, p_order, list->data[i], true);
+    }
+}
+
+static void gpu_block_push(GpuMemoryBlock *r_block, uint32_t p_order, uint32_t p_node) {
+    gpu_node_set_free(r_block, p_order, p_node, true);
+    r_block->free_counts[p_order]++;
+
+    U32Vector *list = &r_block->free_lists[p_order];
+    u32_vector_push_back(list, p_node);
+    if (list->size > (r_block->free_counts[p_order] * 2) + 16) {
+        gpu_block_compact(r_block, p_order);
+    }
+}
+
+static uint32_t gpu_block_pop(GpuMemoryBlock *r_block, uint32_t p_order) {
+    U32Vector *list = &r_block->free_lists[p_order];
+    while (true) {
+        const uint32_t node = list->data[--list->size];
+        if (gpu_node_is_free(r_block, p_order, node)) {
+            gpu_node_set_free(r_block, p_order, node, false);
+            r_block->free_counts[p_order]--;
+            return node;
+        }
+    }
+}
+
+static bool gpu_block_alloc(GpuMemoryBlock *r_block, uint32_t p_order, VkDeviceSize *r_offset) {
+    if (r_block->free_bytes < gpu_order_size(p_order)) {
+        return false;
+    }
+
+    uint32_t order = p_order;
+    while (order < GPU_MEMORY_ORDERS && r_block->free_counts[order] == 0) {
+        order++;
+    }
+    if (order == GPU_MEMORY_ORDERS) {
+        return false;
+    }
+
+    // Split down, keeping the left half and freeing the right.
+    uint32_t node = gpu_block_pop(r_block, order);
+    while (order > p_order) {
+        order--;
+        node <<= 1;
+        gpu_block_push(r_block, order, node | 1);
+    }
+
+    r_block->free_bytes -= gpu_order_size(p_order);
+    *r_offset = node * gpu_order_size(p_order);
+    return true;
+}
+
+static void gpu_block_release(GpuMemoryBlock *r_block, VkDeviceSize p_offset, uint32_t p_order) {
+    r_block->free_bytes += gpu_order_size(p_order);
+
+    uint32_t order = p_order;
+    uint32_t node = p_offset / gpu_order_size(p_order);
+    while (order < GPU_MEMORY_TOP_ORDER && gpu_node_is_free(r_block, order, node ^ 1)) {
+        // Leave the buddy's list entry behind, it goes stale with the bit.
+        gpu_node_set_free(r_block, order, node ^ 1, false);
+        r_block->free_counts[order]--;
+        node >>= 1;
+        order++;
+    }
+    gpu_block_push(r_block, order, node);
+}
+
+/// Device memory
+
+static VkDeviceMemory gpu_device_alloc(GpuAllocator *r_allocator, VkDeviceSize p_size, uint32_t p_memory_type, void **r_mapped) {
+    const uint32_t device_allocations = r_allocator->stats.block_count + r_allocator->stats.dedicated_count;
+    CRASH_COND_MSG(device_allocations >= r_allocator->max_device_allocations, "FATAL: Reached maxMemoryAllocationCount (%u)!", r_allocator->max_device_allocations);
+
+    VkDeviceMemory memory;
+    CRASH_COND_MSG(vkAllocateMemory(r_allocator->device,
+        &(VkMemoryAllocateInfo) {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .allocationSize = p_size,
+            .memoryTypeIndex = p_memory_type,
+        }, NULL, &memory) != VK_SUCCESS,
+        "FATAL: Failed to allocate %llu bytes of device memory!", (unsigned long long)p_size);
+
+    *r_mapped = NULL;
+    if (r_allocator->memory_properties.memoryTypes[p_memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        CRASH_COND_MSG(vkMapMemory(r_allocator->device, memory, 0, VK_WHOLE_SIZE, 0, r_mapped) != VK_SUCCESS, "%s", "FATAL: Failed to map device memory!");
+    }
+
+    r_allocator->stats.reserved_bytes += p_size;
+    return memory;
+}
+
+static void gpu_device_free(GpuAllocator *r_allocator, VkDeviceMemory p_memory, VkDeviceSize p_size) {
+    // Mappings are released implicitly with the memory.
+    vkFreeMemory(r_allocator->device, p_memory, NULL);
+    r_allocator->stats.reserved_bytes -= p_size;
+}
+
+static uint32_t gpu_pool_add_block(GpuAllocator *r_allocator, GpuMemoryBlockVector *r_pool, uint32_t p_memory_type) {
+    // Reuse a released slot so live allocation block indices stay valid.
+    uint32_t idx = 0;
+    while (idx < r_pool->size && r_pool->data[idx].memory != VK_NULL_HANDLE) {
+        idx++;
+    }
+    if (idx == r_pool->size) {
+        gpu_memory_block_vector_push_back(r_pool, (GpuMemoryBlock){ 0 });
+    }
+
+    GpuMemoryBlock *block = gpu_memory_block_vector_get(r_pool, idx);
+    *block = (GpuMemoryBlock){ 0 };
+    block->memory = gpu_device_alloc(r_allocator, GPU_MEMORY_BLOCK_SIZE, p_memory_type, &block->mapped);
+    block->free_bits = mmalloc((GPU_MEMORY_NODE_COUNT + 7) / 8);
+    memset(block->free_bits, 0, (GPU_MEMORY_NODE_COUNT + 7) / 8);
+    gpu_block_push(block, GPU_MEMORY_TOP_ORDER, 0);
+    block->free_bytes = GPU_MEMORY_BLOCK_SIZE;
+
+    r_allocator->stats.block_count++;
+    return idx;
+}
+
+static void gpu_pool_release_block(GpuAllocator *r_allocator, GpuMemoryBlock *r_block) {
+    gpu_device_free(r_allocator, r_block->memory, GPU_MEMORY_BLOCK_SIZE);
+    for (uint32_t i = 0; i < GPU_MEMORY_ORDERS; i++) {
+        u32_vector_free(&r_block->free_lists[i]);
+    }
+    mfree(r_block->free_bits);
+    *r_block = (GpuMemoryBlock){ 0 };
+    r_allocator->stats.block_count--;
+}
+
+/// Interface
+
+void gpu_allocator_init(GpuAllocator *r_allocator, VkPhysicalDevice p_physical_device, VkDevice p_device) {
+    memset(r_allocator, 0, sizeof(GpuAllocator));
+    r_allocator->device = p_device;
+    vkGetPhysicalDeviceMemoryProperties(p_physical_device, &r_allocator->memory_properties);
+
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(p_physical_device, &device_properties);
+    r_allocator->max_device_allocations = device_properties.limits.maxMemoryAllocationCount;
+}
+
+void gpu_allocator_free(GpuAllocator *r_allocator) {
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+        for (uint32_t j = 0; j < GPU_RESOURCE_KIND_MAX; j++) {
+            GpuMemoryBlockVector *pool = &r_allocator->pools[i][j];
+            for (uint32_t k = 0; k < pool->size; k++) {
+                if (pool->data[k].memory != VK_NULL_HANDLE) {
+                    gpu_pool_release_block(r_allocator, &pool->data[k]);
+                }
+            }
+            gpu_memory_block_vector_free(pool);
+        }
+    }
+    ERR_FAIL_COND(r_allocator->stats.dedicated_count != 0);
+}
+
+uint32_t gpu_allocator_find_memory_type(const GpuAllocator *p_allocator, uint32_t p_type_bits, VkMemoryPropertyFlags p_properties) {
+    for (uint32_t i = 0; i < p_allocator->memory_properties.memoryTypeCount; i++) {
+        if ((p_type_bits & (1u << i)) && (p_allocator->memory_properties.memoryTypes[i].propertyFlags & p_properties) == p_properties) {
+            return i;
+        }
+    }
+    CRASH_COND_MSG(true, "%s", "FATAL: Failed to find valid memory type for buffer!");
+}
+
+GpuAllocation gpu_memory_alloc(GpuAllocator *r_allocator, VkMemoryRequirements p_requirements, VkMemoryPropertyFlags p_properties, GpuResourceKind p_kind) {
+    GpuAllocation allocation = { 0 };
+    allocation.memory_type = gpu_allocator_find_memory_type(r_allocator, p_requirements.memoryTypeBits, p_properties);
+    allocation.kind = p_kind;
+    allocation.size = p_requirements.size;
+
+    // Buddy ranges are aligned to their own size, so rounding up to the alignment covers it.
+    VkDeviceSize size = p_requirements.size > p_requirements.alignment ? p_requirements.size : p_requirements.alignment;
+    uint32_t order = 0;
+    while (order < GPU_MEMORY_ORDERS && gpu_order_size(order) < size) {
+        order++;
+    }
+
+    if (size >= GPU_MEMORY_DEDICATED_SIZE) {
+        allocation.memory = gpu_device_alloc(r_allocator, p_requirements.size, allocation.memory_type, &allocation.mapped);
+        allocation.offset = 0;
+        allocation.block = GPU_MEMORY_DEDICATED;
+
+        r_allocator->stats.dedicated_count++;
+        r_allocator->stats.allocation_count++;
+        r_allocator->stats.used_bytes += p_requirements.size;
+        r_allocator->stats.requested_bytes += p_requirements.size;
+        return allocation;
+    }
+
+    GpuMemoryBlockVector *pool = &r_allocator->pools[allocation.memory_type][p_kind];
+    uint32_t block_idx = 0;
+    while (block_idx < pool->size) {
+        GpuMemoryBlock *block = &pool->data[block_idx];
+        if (block->memory != VK_NULL_HANDLE && gpu_block_alloc(block, order, &allocation.offset)) {
+            break;
+        }
+        block_idx++;
+    }
+    if (block_idx == pool->size) {
+        block_idx = gpu_pool_add_block(r_allocator, pool, allocation.memory_type);
+        CRASH_COND_MSG(!gpu_block_alloc(&pool->data[block_idx], order, &allocation.offset), "%s", "FATAL: Failed to sub-allocate from a new memory block!");
+    }
+
+    const GpuMemoryBlock *block = &pool->data[block_idx];
+    allocation.memory = block->memory;
+    allocation.mapped = block->mapped ? (char *)block->mapped + allocation.offset : NULL;
+    allocation.block = block_idx;
+    allocation.order = order;
+
+    r_allocator->stats.allocation_count++;
+    r_allocator->stats.used_bytes += gpu_order_size(order);
+    r_allocator->stats.requested_bytes += p_requirements.size;
+    return allocation;
+}
+
+void gpu_memory_free(GpuAllocator *r_allocator, const GpuAllocation *p_allocation) {
+    if (p_allocation->memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    r_allocator->stats.allocation_count--;
+    r_allocator->stats.requested_bytes -= p_allocation->size;
+
+    if (p_allocation->block == GPU_MEMORY_DEDICATED) {
+        gpu_device_free(r_allocator, p_allocation->memory, p_allocation->size);
+        r_allocator->stats.dedicated_count--;
+        r_allocator->stats.used_bytes -= p_allocation->size;
+        return;
+    }
+
+    GpuMemoryBlockVector *pool = &r_allocator->pools[p_allocation->memory_type][p_allocation->kind];
+    ERR_FAIL_COND(p_allocation->block >= pool->size);
+    GpuMemoryBlock *block = &pool->data[p_allocation->block];
+    gpu_block_release(block, p_allocation->offset, p_allocation->order);
+    r_allocator->stats.used_bytes -= gpu_order_size(p_allocation->order);
+
+    // Keep one empty block around per pool so a free and alloc pair does not hit the driver.
+    if (block->free_bytes == GPU_MEMORY_BLOCK_SIZE) {
+        for (uint32_t i = 0; i < pool->size; i++) {
+            if (i != p_allocation->block && pool->data[i].memory != VK_NULL_HANDLE) {
+                gpu_pool_release_block(r_allocator, block);
+                break;
+            }
+        }
+    }
+}
+
+void gpu_allocator_get_stats(const GpuAllocator *p_allocator, GpuMemoryStats *r_stats) {
+    *r_stats = p_allocator->stats;
+}
+
+void gpu_allocator_dump_stats(const GpuAllocator *p_allocator) {
+    const GpuMemoryStats *stats = &p_allocator->stats;
+    INFO_MSG("GPU memory: %zu blocks, %zu dedicated, %zu / %u device allocations",
+        stats->block_count, stats->dedicated_count, stats->block_count + stats->dedicated_count, p_allocator->max_device_allocations);
+    INFO_MSG("GPU memory: %zu allocations, %llu bytes requested, %llu bytes used, %llu bytes reserved",
+        stats->allocation_count, (unsigned long long)stats->requested_bytes, (unsigned long long)stats->used_bytes, (unsigned long long)stats->reserved_bytes);
+}
+
+/// Staging ring
+
+static void staging_ring_retire_oldest(StagingRing *r_ring) {
+    StagingSubmit *submit = &r_ring->submits[r_ring->submit_first];
+    CRASH_COND_MSG(vkWaitForFences(r_ring->device, 1, &submit->fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS, "%s", "FATAL: Failed to wait for staging fence!");
+    CRASH_COND_MSG(vkResetFences(r_ring->device, 1, &submit->fence) != VK_SUCCESS, "%s", "FATAL: Failed to reset staging fence!");
+    r_ring->tail = submit->end;
+    r_ring->submit_first = (r_ring->submit_first + 1) % STAGING_RING_MAX_SUBMITS;
+    r_ring->submit_count--;
+}
+
+void staging_ring_init(StagingRing *r_ring, GpuAllocator *r_allocator, VkCommandPool p_command_pool, VkDeviceSize p_size) {
+    memset(r_ring, 0, sizeof(StagingRing));
+    r_ring->device = r_allocator->device;
+    r_ring->size = p_size;
+
+    CRASH_COND_MSG(vkCreateBuffer(r_ring->device, &(VkBufferCreateInfo) {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = p_size,
+        .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    }, NULL, &r_ring->buffer) != VK_SUCCESS,
+    "%s", "FATAL: Failed to create staging buffer!");
+
+    VkMemoryRequirements memory_requirements;
+    vkGetBufferMemoryRequirements(r_ring->device, r_ring->buffer, &memory_requirements);
+    r_ring->memory = gpu_memory_alloc(r_allocator, memory_requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, GPU_RESOURCE_BUFFER);
+    CRASH_COND_MSG(vkBindBufferMemory(r_ring->device, r_ring->buffer, r_ring->memory.memory, r_ring->memory.offset) != VK_SUCCESS, "%s", "FATAL: Failed to bind staging buffer!");
+
+    for (uint32_t i = 0; i < STAGING_RING_MAX_SUBMITS; i++) {
+        CRASH_COND_MSG(vkCreateFence(r_ring->device,
+            &(VkFenceCreateInfo) {
+                .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            },
+            NULL, &r_ring->submits[i].fence) != VK_SUCCESS,
+            "%s", "FATAL: Failed to create staging fence!");
+
+        CRASH_COND_MSG(vkAllocateCommandBuffers(r_ring->device,
+            &(VkCommandBufferAllocateInfo) {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                .commandPool = p_command_pool,
+                .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                .commandBufferCount = 1,
+            },
+            &r_ring->submits[i].command_buffer) != VK_SUCCESS,
+            "%s", "FATAL: Failed to create staging command buffer!");
+    }
+}
+
+void staging_ring_free(StagingRing *r_ring, GpuAllocator *r_allocator, VkCommandPool p_command_pool) {
+    staging_ring_wait_idle(r_ring);
+    for (uint32_t i = 0; i < STAGING_RING_MAX_SUBMITS; i++) {
+        vkDestroyFence(r_ring->device, r_ring->submits[i].fence, NULL);
+        vkFreeCommandBuffers(r_ring->device, p_command_pool, 1, &r_ring->submits[i].command_buffer);
+    }
+    vkDestroyBuffer(r_ring->device, r_ring->buffer, NULL);
+    gpu_memory_free(r_allocator, &r_ring->memory);
+}
+
+void *staging_ring_alloc(StagingRing *r_ring, VkDeviceSize p_size, VkDeviceSize *r_offset) {
+    if (p_size > r_ring->size) {
+        return NULL;
+    }
+
+    while (true) {
+        // Skip the remainder of the buffer rather than split a region across the end.
+        uint64_t start = (r_ring->head + STAGING_RING_ALIGNMENT - 1) & ~(uint64_t)(STAGING_RING_ALIGNMENT - 1);
+        if ((start % r_ring->size) + p_size > r_ring->size) {
+            start = ((start / r_ring->size) + 1) * r_ring->size;
+        }
+
+        if (start + p_size - r_ring->tail <= r_ring->size) {
+            r_ring->head = start + p_size;
+            *r_offset = start % r_ring->size;
+            return (char *)r_ring->memory.mapped + *r_offset;
+        }
+
+        // Space held by allocations that are not submitted yet can not be waited on.
+        if (r_ring->submit_count == 0) {
+            return NULL;
+        }
+        staging_ring_retire_oldest(r_ring);
+    }
+}
+
+StagingSubmit *staging_ring_begin(StagingRing *r_ring) {
+    staging_ring_reclaim(r_ring);
+    if (r_ring->submit_count == STAGING_RING_MAX_SUBMITS) {
+        staging_ring_retire_oldest(r_ring);
+    }
+
+    StagingSubmit *submit = &r_ring->submits[(r_ring->submit_first + r_ring->submit_count) % STAGING_RING_MAX_SUBMITS];
+    CRASH_COND_MSG(vkResetCommandBuffer(submit->command_buffer, 0) != VK_SUCCESS, "%s", "FATAL: Failed to reset staging command buffer!");
+    CRASH_COND_MSG(vkBeginCommandBuffer(submit->command_buffer, &(VkCommandBufferBeginInfo){
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    }) != VK_SUCCESS,
+    "%s", "FATAL: Failed to start staging command buffer!");
+    return submit;
+}
+
+void staging_ring_submit(StagingRing *r_ring, StagingSubmit *r_submit, VkQueue p_queue, VkSemaphore p_signal_semaphore) {
+    CRASH_COND_MSG(vkEndCommandBuffer(r_submit->command_buffer) != VK_SUCCESS, "%s", "FATAL: Failed to end staging command buffer!");
+    CRASH_COND_MSG(vkQueueSubmit(p_queue, 1,
+        &(VkSubmitInfo){
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &r_submit->command_buffer,
+            .signalSemaphoreCount = p_signal_semaphore != VK_NULL_HANDLE ? 1 : 0,
+            .pSignalSemaphores = &p_signal_semaphore,
+        }, r_submit->fence) != VK_SUCCESS,
+    "%s", "FATAL: Failed to submit staging command buffer!");
+
+    r_submit->end = r_ring->head;
+    r_ring->submit_count++;
+}
+
+void staging_ring_reclaim(StagingRing *r_ring) {
+    while (r_ring->submit_count > 0 && vkGetFenceStatus(r_ring->device, r_ring->submits[r_ring->submit_first].fence) == VK_SUCCESS) {
+        staging_ring_retire_oldest(r_ring);
+    }
+}
+
+void staging_ring_wait_idle(StagingRing *r_ring) {
+    while (r_ring->submit_count > 0) {
+        staging_ring_retire_oldest(r_ring);
+    }
+}
+
+/// Range allocator
+
+void range_allocator_init(RangeAllocator *r_allocator, uint32_t p_capacity) {
+    r_allocator->capacity = p_capacity;
+    r_allocator->used = 0;
+    r_allocator->free_ranges = (RangeVector){ 0 };
+    range_vector_push_back(&r_allocator->free_ranges, (Range){ 0, p_capacity });
+}
+
+void range_allocator_free(RangeAllocator *r_allocator) {
+    range_vector_free(&r_allocator->free_ranges);
+    r_allocator->capacity = 0;
+    r_allocator->used = 0;
+}
+
+bool range_allocator_alloc(RangeAllocator *r_allocator, uint32_t p_count, uint32_t *r_offset) {
+    if (p_count == 0) {
+        *r_offset = 0;
+        return true;
+    }
+
+    RangeVector *free_ranges = &r_allocator->free_ranges;
+    for (size_t i = 0; i < free_ranges->size; i++) {
+        Range *range = &free_ranges->data[i];
+        if (range->count < p_count) {
+            continue;
+        }
+
+        *r_offset = range->offset;
+        range->offset += p_count;
+        range->count -= p_count;
+        if (range->count == 0) {
+            memmove(range, range + 1, sizeof(Range) * (free_ranges->size - i - 1));
+            free_ranges->size--;
+        }
+        r_allocator->used += p_count;
+        return true;
+    }
+    return false;
+}
+
+void range_allocator_release(RangeAllocator *r_allocator, uint32_t p_offset, uint32_t p_count) {
+    if (p_count == 0) {
+        return;
+    }
+    ERR_FAIL_COND(p_offset + p_count > r_allocator->capacity);
+
+    // First free range past the released one
+    RangeVector *free_ranges = &r_allocator->free_ranges;
+    size_t next = 0;
+    while (next < free_ranges->size && free_ranges->data[next].offset < p_offset) {
+        next++;
+    }
+
+    const bool merge_previous = next > 0 && free_ranges->data[next - 1].offset + free_ranges->data[next - 1].count == p_offset;
+    const bool merge_next = next < free_ranges->size && p_offset + p_count == free_ranges->data[next].offset;
+    if (merge_previous && merge_next) {
+        free_ranges->data[next - 1].count += p_count + free_ranges->data[next].count;
+        memmove(&free_ranges->data[next], &free_ranges->data[next + 1], sizeof(Range) * (free_ranges->size - next - 1));
+        free_ranges->size--;
+    } else if (merge_previous) {
+        free_ranges->data[next - 1].count += p_count;
+    } else if (merge_next) {
+        free_ranges->data[next].offset = p_offset;
+        free_ranges->data[next].count += p_count;
+    } else {
+        range_vector_extend_uninitialized(free_ranges, 1);
+        memmove(&free_ranges->data[next + 1], &free_ranges->data[next], sizeof(Range) * (free_ranges->size - next - 1));
+        free_ranges->data[next] = (Range){ p_offset, p_count };
+    }
+    r_allocator->used -= p_count;
+}
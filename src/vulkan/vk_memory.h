@@ -0,0 +1,162 @@
+#ifndef VK_MEMORY_H_
+#define VK_MEMORY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+
+#include "src/data_structures/vector.h"
+
+// Device memory is reserved in large blocks per memory type and handed out as power of two buddy ranges.
+// Buffers and images live in separate blocks so bufferImageGranularity never applies between neighbours.
+#define GPU_MEMORY_BLOCK_SIZE ((VkDeviceSize)64 * 1024 * 1024)
+#define GPU_MEMORY_MIN_SIZE ((VkDeviceSize)256)
+#define GPU_MEMORY_ORDERS 19 // log2(GPU_MEMORY_BLOCK_SIZE / GPU_MEMORY_MIN_SIZE) + 1
+
+// Requests of this size or more get their own vkAllocateMemory.
+#define GPU_MEMORY_DEDICATED_SIZE (GPU_MEMORY_BLOCK_SIZE / 4)
+#define GPU_MEMORY_DEDICATED UINT32_MAX
+
+typedef enum GpuResourceKind {
+    GPU_RESOURCE_BUFFER,
+    GPU_RESOURCE_IMAGE,
+    GPU_RESOURCE_KIND_MAX,
+} GpuResourceKind;
+
+typedef struct GpuAllocation {
+    VkDeviceMemory memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    void *mapped; // Persistently mapped, NULL unless host visible
+    uint32_t memory_type;
+    uint32_t block; // GPU_MEMORY_DEDICATED when not sub-allocated
+    uint8_t kind;
+    uint8_t order;
+} GpuAllocation;
+
+// Free lists are lazy, entries whose bit in free_bits is clear have been merged and are skipped on pop.
+typedef struct GpuMemoryBlock {
+    VkDeviceMemory memory;
+    void *mapped;
+    VkDeviceSize free_bytes;
+    uint32_t free_counts[GPU_MEMORY_ORDERS];
+    U32Vector free_lists[GPU_MEMORY_ORDERS];
+    uint8_t *free_bits;
+} GpuMemoryBlock;
+
+VECTOR_DEFINE(GpuMemoryBlockVector, gpu_memory_block_vector, GpuMemoryBlock)
+#define gpu_memory_block_vector_reserve(...) gpu_memory_block_vector_reserve(VECTOR_SITE(__VA_ARGS__))
+#define gpu_memory_block_vector_push_back(...) gpu_memory_block_vector_push_back(VECTOR_SITE(__VA_ARGS__))
+#define gpu_memory_block_vector_extend_uninitialized(...) gpu_memory_block_vector_extend_uninitialized(VECTOR_SITE(__VA_ARGS__))
+#define gpu_memory_block_vector_append_range(...) gpu_memory_block_vector_append_range(VECTOR_SITE(__VA_ARGS__))
+#define gpu_memory_block_vector_clone(...) gpu_memory_block_vector_clone(VECTOR_SITE(__VA_ARGS__))
+
+typedef struct GpuMemoryStats {
+    size_t block_count;
+    size_t dedicated_count;
+    size_t allocation_count;
+    VkDeviceSize reserved_bytes; // Everything passed to vkAllocateMemory
+    VkDeviceSize used_bytes; // Handed out, including power of two rounding
+    VkDeviceSize requested_bytes;
+} GpuMemoryStats;
+
+typedef struct GpuAllocator {
+    VkDevice device;
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    uint32_t max_device_allocations;
+    GpuMemoryBlockVector pools[VK_MAX_MEMORY_TYPES][GPU_RESOURCE_KIND_MAX];
+    GpuMemoryStats stats;
+} GpuAllocator;
+
+void gpu_allocator_init(GpuAllocator *r_allocator, VkPhysicalDevice p_physical_device, VkDevice p_device);
+
+// All allocations must already be released.
+void gpu_allocator_free(GpuAllocator *r_allocator);
+
+uint32_t gpu_allocator_find_memory_type(const GpuAllocator *p_allocator, uint32_t p_type_bits, VkMemoryPropertyFlags p_properties);
+
+GpuAllocation gpu_memory_alloc(GpuAllocator *r_allocator, VkMemoryRequirements p_requirements, VkMemoryPropertyFlags p_properties, GpuResourceKind p_kind);
+
+void gpu_memory_free(GpuAllocator *r_allocator, const GpuAllocation *p_allocation);
+
+void gpu_allocator_get_stats(const GpuAllocator *p_allocator, GpuMemoryStats *r_stats);
+
+void gpu_allocator_dump_stats(const GpuAllocator *p_allocator);
+
+/// Staging ring
+
+// Persistently mapped upload buffer sized at startup. Space is handed out in order and
+// retired once the fence of the submit that read it signals, so uploads never idle the queue.
+#define STAGING_RING_SIZE ((VkDeviceSize)32 * 1024 * 1024)
+#define STAGING_RING_ALIGNMENT 16
+#define STAGING_RING_MAX_SUBMITS 16
+
+typedef struct StagingSubmit {
+    VkFence fence;
+    VkCommandBuffer command_buffer;
+    uint64_t end; // Ring position released when the fence signals
+} StagingSubmit;
+
+// head and tail only ever grow, the buffer offset is the position modulo size.
+typedef struct StagingRing {
+    VkDevice device;
+    VkBuffer buffer;
+    GpuAllocation memory;
+    VkDeviceSize size;
+    uint64_t head;
+    uint64_t tail;
+    StagingSubmit submits[STAGING_RING_MAX_SUBMITS];
+    uint32_t submit_first;
+    uint32_t submit_count;
+} StagingRing;
+
+void staging_ring_init(StagingRing *r_ring, GpuAllocator *r_allocator, VkCommandPool p_command_pool, VkDeviceSize p_size);
+
+void staging_ring_free(StagingRing *r_ring, GpuAllocator *r_allocator, VkCommandPool p_command_pool);
+
+// Returns NULL when p_size can not fit even with nothing in flight, callers fall back to a temporary buffer.
+void *staging_ring_alloc(StagingRing *r_ring, VkDeviceSize p_size, VkDeviceSize *r_offset);
+
+// Claims the next submit slot with its command buffer ready to record, waiting when all are in flight.
+StagingSubmit *staging_ring_begin(StagingRing *r_ring);
+
+// Submits the slot, everything allocated since the last submit is released with its fence.
+// p_signal_semaphore may be VK_NULL_HANDLE.
+void staging_ring_submit(StagingRing *r_ring, StagingSubmit *r_submit, VkQueue p_queue, VkSemaphore p_signal_semaphore);
+
+void staging_ring_reclaim(StagingRing *r_ring);
+
+void staging_ring_wait_idle(StagingRing *r_ring);
+
+/// Range allocator
+
+// Hands out ranges of a fixed capacity in caller defined units, e.g. vertices of a shared buffer.
+// First fit over free ranges sorted by offset, neighbours merge on release.
+typedef struct Range {
+    uint32_t offset;
+    uint32_t count;
+} Range;
+
+VECTOR_DEFINE(RangeVector, range_vector, Range)
+#define range_vector_reserve(...) range_vector_reserve(VECTOR_SITE(__VA_ARGS__))
+#define range_vector_push_back(...) range_vector_push_back(VECTOR_SITE(__VA_ARGS__))
+#define range_vector_extend_uninitialized(...) range_vector_extend_uninitialized(VECTOR_SITE(__VA_ARGS__))
+#define range_vector_append_range(...) range_vector_append_range(VECTOR_SITE(__VA_ARGS__))
+#define range_vector_clone(...) range_vector_clone(VECTOR_SITE(__VA_ARGS__))
+
+typedef struct RangeAllocator {
+    RangeVector free_ranges;
+    uint32_t capacity;
+    uint32_t used;
+} RangeAllocator;
+
+void range_allocator_init(RangeAllocator *r_allocator, uint32_t p_capacity);
+
+void range_allocator_free(RangeAllocator *r_allocator);
+
+// Returns false when no free range is large enough. Zero sized requests always succeed.
+bool range_allocator_alloc(RangeAllocator *r_allocator, uint32_t p_count, uint32_t *r_offset);
+
+void range_allocator_release(RangeAllocator *r_allocator, uint32_t p_offset, uint32_t p_count);
+
+#endif
@@ -1,15 +1,27 @@
 #include "vk_renderer.h"
 
+#include <math.h>
+#include <string.h>
 #include <stdbool.h>
 
+#include "src/io/memory.h"
+#include "src/jobs/jobs.h"
+
+// Decoding scratch lives in the scratch arena for the duration of texture_create.
+static _Thread_local Arena *image_arena = NULL;
+#define STBI_MALLOC(m_size) arena_alloc(image_arena, m_size)
+#define STBI_REALLOC_SIZED(m_ptr, m_old_size, m_new_size) arena_realloc(image_arena, m_ptr, m_old_size, m_new_size)
+#define STBI_FREE(m_ptr) ((void)(m_ptr))
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
 #include "src/math/angles.h"
+#include "src/math/simplify.h"
 #include "src/object.h"
 #include "src/camera.h"
-#include "src/io/memory.h"
 #include "src/io/io.h"
+#include "src/data_structures/radix_sort.h"
 #include "src/error/error.h"
 
 /// CommandBuffers
@@ -36,80 +48,172 @@ static void command_buffer_start(const VkCommandBuffer *p_command_buffer, VkComm
     "%s", "FATAL: Failed to start command buffer recording!");
 }
 
-static void command_buffer_submit(const Window *p_window, const VkCommandBuffer *p_command_buffer, const VkFence p_fence) {
-    CRASH_COND_MSG(vkEndCommandBuffer(*p_command_buffer) != VK_SUCCESS, "%s", "FATAL: Failed to end command buffer!");
-    CRASH_COND_MSG(vkQueueSubmit(p_window->vk_queue, 1,
-        &(VkSubmitInfo){
-            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            .commandBufferCount = 1,
-            .pCommandBuffers = p_command_buffer,
-        }, p_fence) != VK_SUCCESS,
-    "%s", "FATAL: Failed to submit command buffer!");
-}
-
-static void command_bufffer_free(const VkRenderer *p_vk_renderer, const Window *p_window, VkCommandBuffer *r_command_buffer) {
-    vkFreeCommandBuffers(p_window->vk_device, p_vk_renderer->command_pool, 1, r_command_buffer);
-}
-
 /// Memory
-uint32_t memory_get_requrement_idx(VkMemoryRequirements p_vk_memory_requirements, VkPhysicalDeviceMemoryProperties p_vk_memory_properties, uint32_t p_properties) {
-    for (uint32_t i = 0; i < p_vk_memory_properties.memoryTypeCount; i++) {
-        if ((p_vk_memory_requirements.memoryTypeBits & (1 << i)) && (p_vk_memory_properties.memoryTypes[i].propertyFlags & p_properties) == p_properties) {
-            return i;
-        }
-    }
-    CRASH_COND_MSG(true, "%s", "FATAL: Failed to find valid memory type for buffer!");
-}
 
-void memory_create_vkbuffer(VkDevice p_device, VkPhysicalDevice p_physical_device, VkDeviceSize p_size, VkBufferUsageFlags p_usage, VkMemoryPropertyFlags p_properties, VkBuffer *p_buffer, VkDeviceMemory *p_buffer_memory) {
+// Concurrent between p_queue_families when there is more than one, exclusive otherwise.
+static void memory_create_shared_vkbuffer(GpuAllocator *r_allocator, VkDevice p_device, VkDeviceSize p_size, VkBufferUsageFlags p_usage, VkMemoryPropertyFlags p_properties, uint32_t p_queue_family_count, const uint32_t *p_queue_families, VkBuffer *r_buffer, GpuAllocation *r_allocation) {
     CRASH_COND_MSG(vkCreateBuffer(p_device, &(VkBufferCreateInfo) {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .size = p_size,
         .usage = p_usage,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-    }, NULL, p_buffer) != VK_SUCCESS,
+        .sharingMode = p_queue_family_count > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = p_queue_family_count > 1 ? p_queue_family_count : 0,
+        .pQueueFamilyIndices = p_queue_family_count > 1 ? p_queue_families : NULL,
+    }, NULL, r_buffer) != VK_SUCCESS,
     "%s", "FATAL: Failed to create memory buffer!");
 
     VkMemoryRequirements vk_memory_requrements;
-    vkGetBufferMemoryRequirements(p_device, *p_buffer, &vk_memory_requrements);
+    vkGetBufferMemoryRequirements(p_device, *r_buffer, &vk_memory_requrements);
 
-    VkPhysicalDeviceMemoryProperties vk_memory_properties;
-    vkGetPhysicalDeviceMemoryProperties(p_physical_device, &vk_memory_properties);
-
-    // Check max supported allocations, and use offset instead
-    CRASH_COND_MSG(vkAllocateMemory(p_device,
-        &(VkMemoryAllocateInfo) {
-            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .allocationSize = vk_memory_requrements.size,
-            .memoryTypeIndex = memory_get_requrement_idx(vk_memory_requrements, vk_memory_properties, p_properties),
-        }, NULL, p_buffer_memory) != VK_SUCCESS,
-        "%s", "FATAL: Failed to allocate memory for buffer!");
+    *r_allocation = gpu_memory_alloc(r_allocator, vk_memory_requrements, p_properties, GPU_RESOURCE_BUFFER);
+    CRASH_COND_MSG(vkBindBufferMemory(p_device, *r_buffer, r_allocation->memory, r_allocation->offset) != VK_SUCCESS, "%s", "FATAL: Failed to bind vKBuffer!");
+}
 
-    CRASH_COND_MSG(vkBindBufferMemory(p_device, *p_buffer, *p_buffer_memory, 0) != VK_SUCCESS, "%s", "FATAL: Failed to bind vKBuffer!");
+static void memory_create_vkbuffer(GpuAllocator *r_allocator, VkDevice p_device, VkDeviceSize p_size, VkBufferUsageFlags p_usage, VkMemoryPropertyFlags p_properties, VkBuffer *r_buffer, GpuAllocation *r_allocation) {
+    memory_create_shared_vkbuffer(r_allocator, p_device, p_size, p_usage, p_properties, 0, NULL, r_buffer, r_allocation);
 }
 
-static void memory_create_image_buffer(VkDevice p_device, VkPhysicalDevice p_physical_device, VkImage p_image, VkDeviceMemory *r_buffer) {
+static void memory_create_image_buffer(GpuAllocator *r_allocator, VkDevice p_device, VkImage p_image, GpuAllocation *r_allocation) {
     VkMemoryRequirements memory_requirements;
     vkGetImageMemoryRequirements(p_device, p_image, &memory_requirements);
 
-    VkPhysicalDeviceMemoryProperties memory_properties;
-    vkGetPhysicalDeviceMemoryProperties(p_physical_device, &memory_properties);
+    *r_allocation = gpu_memory_alloc(r_allocator, memory_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, GPU_RESOURCE_IMAGE);
+    CRASH_COND_MSG(vkBindImageMemory(p_device, p_image, r_allocation->memory, r_allocation->offset) != VK_SUCCESS, "%s", "FATAL: Failed to bind image buffer!");
+}
 
-    CRASH_COND_MSG(vkAllocateMemory(p_device,
-        &(VkMemoryAllocateInfo) {
-            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .allocationSize = memory_requirements.size,
-            .memoryTypeIndex = memory_get_requrement_idx(memory_requirements, memory_properties, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
-        }, NULL, r_buffer) != VK_SUCCESS,
-        "%s", "FATAL: Failed to allocate memory for image buffer!");
-    CRASH_COND_MSG(vkBindImageMemory(p_device, p_image, *r_buffer, 0) != VK_SUCCESS, "%s", "FATAL: Failed to bind image buffer!");
+static void memory_free_vkbuffer(GpuAllocator *r_allocator, VkDevice p_device, VkBuffer p_buffer, const GpuAllocation *p_allocation) {
+    vkDestroyBuffer(p_device, p_buffer, NULL);
+    gpu_memory_free(r_allocator, p_allocation);
 }
 
-static void memory_transition_image(const VkRenderer *p_vk_renderer, const Window *p_window, VkImage p_image, VkImageLayout p_old_layout, VkImageLayout p_new_layout) {
-    VkCommandBuffer cmd_buffer;
-    command_bufffer_create(p_vk_renderer, p_window, &cmd_buffer);
-    command_buffer_start(&cmd_buffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+/// Uploads
+
+static void upload_batch_record(VkRenderer *r_vk_renderer) {
+    r_vk_renderer->upload_batch.submit = staging_ring_begin(&r_vk_renderer->staging_ring);
+}
+
+static VkSemaphore upload_semaphore_get(VkRenderer *r_vk_renderer, const Window *p_window) {
+    VkSemaphoreVector *free_semaphores = &r_vk_renderer->upload_acquire.free_semaphores;
+    if (free_semaphores->size > 0) {
+        return free_semaphores->data[--free_semaphores->size];
+    }
+
+    VkSemaphore semaphore;
+    CRASH_COND_MSG(vkCreateSemaphore(p_window->vk_device,
+        &(VkSemaphoreCreateInfo) {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        },
+        NULL, &semaphore) != VK_SUCCESS,
+        "%s", "FATAL: Failed to create upload semaphore!");
+    return semaphore;
+}
+
+static void upload_batch_flush(VkRenderer *r_vk_renderer, const Window *p_window) {
+    UploadBatch *batch = &r_vk_renderer->upload_batch;
+    UploadAcquire *acquire = &r_vk_renderer->upload_acquire;
+    const VkCommandBuffer cmd_buffer = batch->submit->command_buffer;
+
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    if (p_window->vk_transfer_queue_index == p_window->vk_queue_index) {
+        // One barrier makes every copy in the batch visible to later submits on the queue.
+        for (size_t i = 0; i < batch->image_barriers.size; i++) {
+            batch->image_barriers.data[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        }
+        vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &(VkMemoryBarrier){
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT,
+        }, 0, NULL, batch->image_barriers.size, batch->image_barriers.data);
+    } else {
+        // Release to the graphics family, the next frame waits on the semaphore and acquires with matching barriers.
+        vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL,
+            batch->buffer_barriers.size, batch->buffer_barriers.data, batch->image_barriers.size, batch->image_barriers.data);
+
+        for (size_t i = 0; i < batch->buffer_barriers.size; i++) {
+            VkBufferMemoryBarrier barrier = batch->buffer_barriers.data[i];
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+            buffer_barrier_vector_push_back(&acquire->buffer_barriers, barrier);
+        }
+        for (size_t i = 0; i < batch->image_barriers.size; i++) {
+            VkImageMemoryBarrier barrier = batch->image_barriers.data[i];
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            image_barrier_vector_push_back(&acquire->image_barriers, barrier);
+        }
+
+        semaphore = upload_semaphore_get(r_vk_renderer, p_window);
+        vk_semaphore_vector_push_back(&acquire->semaphores, semaphore);
+    }
+    buffer_barrier_vector_clear(&batch->buffer_barriers);
+    image_barrier_vector_clear(&batch->image_barriers);
+    staging_ring_submit(&r_vk_renderer->staging_ring, batch->submit, p_window->vk_transfer_queue, semaphore);
+
+    if (batch->temporaries.size > 0) {
+        CRASH_COND_MSG(vkWaitForFences(p_window->vk_device, 1, &batch->submit->fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS, "%s", "FATAL: Failed to wait for upload fence!");
+        for (size_t i = 0; i < batch->temporaries.size; i++) {
+            memory_free_vkbuffer(&r_vk_renderer->gpu_allocator, p_window->vk_device, batch->temporaries.data[i].buffer, &batch->temporaries.data[i].memory);
+        }
+        staging_temporary_vector_clear(&batch->temporaries);
+    }
+    batch->submit = NULL;
+}
+
+// Records the acquire half of pending ownership transfers and makes the frame wait on their uploads.
+static void upload_acquire_record(VkRenderer *r_vk_renderer, VkCommandBuffer p_cmd_buffer, FrameData *r_frame_data) {
+    UploadAcquire *acquire = &r_vk_renderer->upload_acquire;
+    if (acquire->semaphores.size == 0) {
+        return;
+    }
+
+    vkCmdPipelineBarrier(p_cmd_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, NULL,
+        acquire->buffer_barriers.size, acquire->buffer_barriers.data, acquire->image_barriers.size, acquire->image_barriers.data);
+
+    for (size_t i = 0; i < acquire->semaphores.size; i++) {
+        vk_semaphore_vector_push_back(&r_frame_data->wait_semaphores, acquire->semaphores.data[i]);
+        u32_vector_push_back(&r_frame_data->wait_stages, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    }
+    buffer_barrier_vector_clear(&acquire->buffer_barriers);
+    image_barrier_vector_clear(&acquire->image_barriers);
+    vk_semaphore_vector_clear(&acquire->semaphores);
+}
+
+void vk_renderer_upload_begin(VkRenderer *r_vk_renderer) {
+    if (r_vk_renderer->upload_batch.depth++ == 0) {
+        upload_batch_record(r_vk_renderer);
+    }
+}
 
+void vk_renderer_upload_submit(VkRenderer *r_vk_renderer, const Window *p_window) {
+    ERR_FAIL_COND(r_vk_renderer->upload_batch.depth == 0);
+    if (--r_vk_renderer->upload_batch.depth == 0) {
+        upload_batch_flush(r_vk_renderer, p_window);
+    }
+}
+
+// Staging space comes from the ring, uploads larger than it get a temporary buffer freed with the batch.
+static void *upload_batch_stage(VkRenderer *r_vk_renderer, const Window *p_window, VkDeviceSize p_size, VkBuffer *r_buffer, VkDeviceSize *r_offset) {
+    void *data = staging_ring_alloc(&r_vk_renderer->staging_ring, p_size, r_offset);
+    if (!data && p_size <= r_vk_renderer->staging_ring.size) {
+        // The ring is full of this batch, submit what is recorded so far so it can be waited on.
+        upload_batch_flush(r_vk_renderer, p_window);
+        upload_batch_record(r_vk_renderer);
+        data = staging_ring_alloc(&r_vk_renderer->staging_ring, p_size, r_offset);
+    }
+    if (data) {
+        *r_buffer = r_vk_renderer->staging_ring.buffer;
+        return data;
+    }
+
+    StagingTemporary temporary;
+    memory_create_vkbuffer(&r_vk_renderer->gpu_allocator, p_window->vk_device, p_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &temporary.buffer, &temporary.memory);
+    staging_temporary_vector_push_back(&r_vk_renderer->upload_batch.temporaries, temporary);
+    *r_buffer = temporary.buffer;
+    *r_offset = 0;
+    return temporary.memory.mapped;
+}
+
+static void memory_transition_image(VkCommandBuffer p_cmd_buffer, VkImage p_image, VkImageLayout p_old_layout, VkImageLayout p_new_layout) {
     VkPipelineStageFlags source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
     VkAccessFlags source_flags = 0;
 
@@ -124,7 +228,7 @@ static void memory_transition_image(const VkRenderer *p_vk_renderer, const Windo
         destination_flags = VK_ACCESS_SHADER_READ_BIT;
     }
 
-    vkCmdPipelineBarrier(cmd_buffer, source_stage, destination_stage, 0, 0, NULL, 0, NULL, 1, &(VkImageMemoryBarrier){
+    vkCmdPipelineBarrier(p_cmd_buffer, source_stage, destination_stage, 0, 0, NULL, 0, NULL, 1, &(VkImageMemoryBarrier){
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
         .oldLayout = p_old_layout,
         .newLayout = p_new_layout,
@@ -141,36 +245,25 @@ static void memory_transition_image(const VkRenderer *p_vk_renderer, const Windo
         .srcAccessMask = source_flags,
         .dstAccessMask = destination_flags,
     });
-
-    command_buffer_submit(p_window, &cmd_buffer, VK_NULL_HANDLE);
-    CRASH_COND_MSG(vkQueueWaitIdle(p_window->vk_queue) != VK_SUCCESS, "%s", "FATAL: Failed to wait for queue!");
-    command_bufffer_free(p_vk_renderer, p_window, &cmd_buffer);
 }
 
-static void memory_upload_image(const VkRenderer *p_vk_renderer, const Window *p_window, VkImage p_image, void *p_data, int p_texture_width, int p_texture_height, VkDeviceMemory *r_buffer) {
-    // Create and load into stating buffer
+static void memory_upload_image(VkRenderer *p_vk_renderer, const Window *p_window, VkImage p_image, void *p_data, int p_texture_width, int p_texture_height, GpuAllocation *r_allocation) {
+    vk_renderer_upload_begin(p_vk_renderer);
+
+    // Load into stating buffer
     VkDeviceSize data_size = p_texture_width * p_texture_height * 4;
     VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
-    memory_create_vkbuffer(p_window->vk_device, p_window->vk_physical_device, data_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &staging_buffer, &staging_buffer_memory);
-
-    void *image_data;
-    CRASH_COND_MSG(vkMapMemory(p_window->vk_device, staging_buffer_memory, 0, data_size, 0, &image_data) != VK_SUCCESS, "%s", "FATAL: Failed to map device memory!");
-    memcpy(image_data, p_data, data_size);
-    vkUnmapMemory(p_window->vk_device, staging_buffer_memory);
+    VkDeviceSize staging_offset;
+    memcpy(upload_batch_stage(p_vk_renderer, p_window, data_size, &staging_buffer, &staging_offset), p_data, data_size);
 
     // Load into device
-    memory_create_image_buffer(p_window->vk_device, p_window->vk_physical_device, p_image, r_buffer);
-
-    // Update format
-    memory_transition_image(p_vk_renderer, p_window, p_image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    memory_create_image_buffer(&p_vk_renderer->gpu_allocator, p_window->vk_device, p_image, r_allocation);
 
-    // Reupload new format
-    VkCommandBuffer cmd_buffer;
-    command_bufffer_create(p_vk_renderer, p_window, &cmd_buffer);
-    command_buffer_start(&cmd_buffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    // Update format, upload, then make it readable
+    const VkCommandBuffer cmd_buffer = p_vk_renderer->upload_batch.submit->command_buffer;
+    memory_transition_image(cmd_buffer, p_image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
     vkCmdCopyBufferToImage(cmd_buffer, staging_buffer, p_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &(VkBufferImageCopy) {
-        .bufferOffset = 0,
+        .bufferOffset = staging_offset,
         .bufferRowLength = 0,
         .bufferImageHeight = 0,
 
@@ -186,50 +279,340 @@ static void memory_upload_image(const VkRenderer *p_vk_renderer, const Window *p
             1
         },
     });
-    command_buffer_submit(p_window, &cmd_buffer, VK_NULL_HANDLE);
-    CRASH_COND_MSG(vkQueueWaitIdle(p_window->vk_queue) != VK_SUCCESS, "%s", "FATAL: Failed to wait for queue!");
-    command_bufffer_free(p_vk_renderer, p_window, &cmd_buffer);
 
-    // Update format
-    memory_transition_image(p_vk_renderer, p_window, p_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    // Made readable when the batch flushes, along with the queue family release on a transfer queue
+    image_barrier_vector_push_back(&p_vk_renderer->upload_batch.image_barriers, (VkImageMemoryBarrier){
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .srcQueueFamilyIndex = p_window->vk_transfer_queue_index,
+        .dstQueueFamilyIndex = p_window->vk_queue_index,
+        .image = p_image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+    });
 
-    // Free memory
-    vkDestroyBuffer(p_window->vk_device, staging_buffer, NULL);
-    vkFreeMemory(p_window->vk_device, staging_buffer_memory, NULL);
+    vk_renderer_upload_submit(p_vk_renderer, p_window);
 }
 
-static void memory_upload_data(const VkRenderer *p_vk_renderer, const Window *p_window, void *p_data, size_t p_data_size, VkBuffer *r_vk_buffer, VkDeviceMemory *r_device_memory, VkBufferUsageFlags p_useage_flags) {
-    // Create and load into stating buffer
+// Copies into a range of a buffer shared with the transfer family, the batch semaphore or barrier orders it.
+static void memory_upload_range(VkRenderer *p_vk_renderer, const Window *p_window, const void *p_data, size_t p_data_size, VkBuffer p_vk_buffer, VkDeviceSize p_offset) {
+    if (p_data_size == 0) {
+        return;
+    }
+    vk_renderer_upload_begin(p_vk_renderer);
+
     VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
-    memory_create_vkbuffer(p_window->vk_device, p_window->vk_physical_device, p_data_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &staging_buffer, &staging_buffer_memory);
+    VkDeviceSize staging_offset;
+    memcpy(upload_batch_stage(p_vk_renderer, p_window, p_data_size, &staging_buffer, &staging_offset), p_data, p_data_size);
+
+    vkCmdCopyBuffer(p_vk_renderer->upload_batch.submit->command_buffer, staging_buffer, p_vk_buffer, 1, &(VkBufferCopy){
+        .srcOffset = staging_offset,
+        .dstOffset = p_offset,
+        .size = p_data_size,
+    });
+
+    vk_renderer_upload_submit(p_vk_renderer, p_window);
+}
+
+/// Geometry
+
+static void geometry_buffer_init(VkRenderer *r_vk_renderer, const Window *p_window, GeometryBuffer *r_geometry, uint32_t p_capacity, VkDeviceSize p_stride, VkBufferUsageFlags p_usage) {
+    const uint32_t queue_families[2] = { p_window->vk_queue_index, p_window->vk_transfer_queue_index };
+    memory_create_shared_vkbuffer(&r_vk_renderer->gpu_allocator, p_window->vk_device, p_stride * p_capacity, VK_BUFFER_USAGE_TRANSFER_DST_BIT | p_usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        queue_families[0] != queue_families[1] ? 2 : 1, queue_families, &r_geometry->buffer, &r_geometry->memory);
+    range_allocator_init(&r_geometry->ranges, p_capacity);
+}
+
+static void geometry_buffer_free(VkRenderer *r_vk_renderer, const Window *p_window, GeometryBuffer *r_geometry) {
+    memory_free_vkbuffer(&r_vk_renderer->gpu_allocator, p_window->vk_device, r_geometry->buffer, &r_geometry->memory);
+    range_allocator_free(&r_geometry->ranges);
+}
+
+// Called once the frame's fence signaled, nothing in flight reads the ranges or textures any more.
+static void frame_release_retired(VkRenderer *r_vk_renderer, const Window *p_window, FrameData *r_frame_data) {
+    for (size_t i = 0; i < r_frame_data->retired_vertices.size; i++) {
+        range_allocator_release(&r_vk_renderer->vertex_geometry.ranges, r_frame_data->retired_vertices.data[i].offset, r_frame_data->retired_vertices.data[i].count);
+    }
+    for (size_t i = 0; i < r_frame_data->retired_indices.size; i++) {
+        range_allocator_release(&r_vk_renderer->index_geometry.ranges, r_frame_data->retired_indices.data[i].offset, r_frame_data->retired_indices.data[i].count);
+    }
+    for (size_t i = 0; i < r_frame_data->retired_meshlets.size; i++) {
+        range_allocator_release(&r_vk_renderer->meshlet_geometry.ranges, r_frame_data->retired_meshlets.data[i].offset, r_frame_data->retired_meshlets.data[i].count);
+    }
+    range_vector_clear(&r_frame_data->retired_vertices);
+    range_vector_clear(&r_frame_data->retired_indices);
+    range_vector_clear(&r_frame_data->retired_meshlets);
+
+    for (size_t i = 0; i < r_frame_data->retired_textures.size; i++) {
+        const RetiredTexture *texture = &r_frame_data->retired_textures.data[i];
+        vkDestroyImageView(p_window->vk_device, texture->image_view, NULL);
+        vkDestroyImage(p_window->vk_device, texture->image, NULL);
+        gpu_memory_free(&r_vk_renderer->gpu_allocator, &texture->memory);
+        u32_vector_push_back(&r_vk_renderer->free_texture_indices, texture->index);
+    }
+    retired_texture_vector_clear(&r_frame_data->retired_textures);
+}
+
+/// Draw list
+
+// Sort key from the most significant bits down: pipeline, mesh, level of detail, texture, then view
+// depth so the instances of a run sample one texture after another, each drawn nearest first.
+// Ids wrap, a collision only splits or interleaves runs since batching compares the pointers.
+#define DRAW_KEY_PIPELINE_SHIFT 56
+#define DRAW_KEY_MESH_SHIFT 39
+#define DRAW_KEY_LOD_SHIFT 36
+#define DRAW_KEY_TEXTURE_SHIFT 16
+#define DRAW_KEY_MESH_MASK ((1u << 17) - 1)
+#define DRAW_KEY_ID_MASK ((1u << 20) - 1)
+#define DRAW_KEY_DEPTH_MAX 0xffff
+
+// Only the one opaque pipeline for now.
+#define DRAW_PIPELINE_OPAQUE 0
+
+static uint64_t draw_key(uint32_t p_pipeline, const Surface *p_surface, uint32_t p_lod, float p_depth) {
+    const float depth = SDL_clamp(p_depth, 0.0f, 1.0f);
+    return ((uint64_t)p_pipeline << DRAW_KEY_PIPELINE_SHIFT)
+        | ((uint64_t)(p_surface->mesh->sort_id & DRAW_KEY_MESH_MASK) << DRAW_KEY_MESH_SHIFT)
+        | ((uint64_t)p_lod << DRAW_KEY_LOD_SHIFT)
+        | ((uint64_t)(p_surface->texture->sort_id & DRAW_KEY_ID_MASK) << DRAW_KEY_TEXTURE_SHIFT)
+        | (uint64_t)(depth * DRAW_KEY_DEPTH_MAX);
+}
+
+// Surfaces drawn by one instanced draw, the texture is per instance.
+static bool draw_same_batch(const Surface *p_a, uint32_t p_lod_a, const Surface *p_b, uint32_t p_lod_b) {
+    return p_a->mesh == p_b->mesh && p_lod_a == p_lod_b;
+}
+
+// Coarsest level whose error, projected at the nearest point of the bounds, stays under
+// MESH_LOD_MAX_SCREEN_ERROR. p_pixels_per_unit is the size in pixels of one unit one unit away.
+static uint32_t draw_select_lod(const Mesh *p_mesh, float p_distance, float p_pixels_per_unit) {
+    uint32_t lod = 0;
+    while (lod + 1 < p_mesh->lod_count && p_mesh->lods[lod + 1].error * p_pixels_per_unit <= MESH_LOD_MAX_SCREEN_ERROR * p_distance) {
+        lod++;
+    }
+    return lod;
+}
+
+// Tracks what is bound while recording so binds matching the previous draw are skipped.
+typedef struct DrawState {
+    VkCommandBuffer cmd_buffer;
+    VkPipeline pipeline;
+    DrawStats *stats;
+} DrawState;
+
+static void draw_state_bind_pipeline(DrawState *r_state, VkPipeline p_pipeline) {
+    if (r_state->pipeline == p_pipeline) {
+        return;
+    }
+    vkCmdBindPipeline(r_state->cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, p_pipeline);
+    r_state->pipeline = p_pipeline;
+    r_state->stats->pipeline_binds++;
+}
 
-    void *data;
-    CRASH_COND_MSG(vkMapMemory(p_window->vk_device, staging_buffer_memory, 0, p_data_size, 0, &data) != VK_SUCCESS, "%s", "FATAL: Failed to map device memory!");
-    memcpy(data, p_data, p_data_size);
-    vkUnmapMemory(p_window->vk_device, staging_buffer_memory);
 
-    // Create device buffer
-    memory_create_vkbuffer(p_window->vk_device, p_window->vk_physical_device, p_data_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | p_useage_flags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, r_vk_buffer, r_device_memory);
+/// Recording
 
-    // Upload data
+typedef struct RecordChunk {
+    const VkRenderer *renderer;
+    const FrameData *frame_data;
+    VkDevice device;
+    VkCommandPool command_pool;
     VkCommandBuffer cmd_buffer;
-    command_bufffer_create(p_vk_renderer, p_window, &cmd_buffer);
-    command_buffer_start(&cmd_buffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    VkFramebuffer framebuffer;
+    const Object *objects_data;
+    const uint32_t *draw_objects;
+    const uint8_t *lods; // Per object
+    const size_t *run_ends;
+    size_t run_first;
+    size_t run_last;
+    bool gpu_culling;
+    uint32_t meshlet_draw_count; // Most draws of the meshlet pass, only the first chunk draws them
+    DrawStats stats;
+} RecordChunk;
+
+// Secondaries inherit only the render pass, every chunk binds its own state.
+static void record_chunk(RecordChunk *r_chunk) {
+    const VkRenderer *renderer = r_chunk->renderer;
+    const FrameData *frame_data = r_chunk->frame_data;
+    const Object *objects_data = r_chunk->objects_data;
+    const uint32_t *draw_objects = r_chunk->draw_objects;
+    const size_t *run_ends = r_chunk->run_ends;
+    const VkCommandBuffer cmd_buffer = r_chunk->cmd_buffer;
+    DrawStats *stats = &r_chunk->stats;
+    *stats = (DrawStats){ 0 };
+
+    CRASH_COND_MSG(vkResetCommandPool(r_chunk->device, r_chunk->command_pool, 0) != VK_SUCCESS, "%s", "FATAL: Failed to reset record command pool!");
+    CRASH_COND_MSG(vkBeginCommandBuffer(cmd_buffer, &(VkCommandBufferBeginInfo){
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+        .pInheritanceInfo = &(VkCommandBufferInheritanceInfo){
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+            .renderPass = renderer->renderpass,
+            .subpass = 0,
+            .framebuffer = r_chunk->framebuffer,
+        },
+    }) != VK_SUCCESS,
+    "%s", "FATAL: Failed to start record command buffer!");
 
-    vkCmdCopyBuffer(cmd_buffer, staging_buffer, *r_vk_buffer, 1, &(VkBufferCopy){
-        .srcOffset = 0,
-        .dstOffset = 0,
-        .size = p_data_size,
-    });
+    DrawState state = {
+        .cmd_buffer = cmd_buffer,
+        .pipeline = VK_NULL_HANDLE,
+        .stats = stats,
+    };
+    draw_state_bind_pipeline(&state, renderer->pipeline);
+    vkCmdSetViewport(cmd_buffer, 0, 1, &renderer->vk_viewport);
+    vkCmdSetScissor(cmd_buffer, 0, 1, &renderer->vk_scissor);
+
+    vkCmdPushConstants(cmd_buffer, renderer->pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(FragPushConstants), &renderer->frag_push_constants);
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, renderer->pipeline_layout, 0, 2, (VkDescriptorSet[]){ frame_data->camera_descriptor_set, renderer->texture_set }, 0, NULL);
+    stats->descriptor_set_binds++;
+
+    // Every mesh lives in the geometry buffers and every texture in set 1, nothing changes between runs
+    vkCmdBindIndexBuffer(cmd_buffer, renderer->index_geometry.buffer, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdBindVertexBuffers(cmd_buffer, 0, 2, (VkBuffer[]){ renderer->vertex_geometry.buffer, frame_data->instance_buffer }, (VkDeviceSize[]){ 0, 0 });
+    stats->index_buffer_binds++;
+    stats->vertex_buffer_binds++;
+
+    if (r_chunk->meshlet_draw_count > 0) {
+        vkCmdDrawIndexedIndirectCount(cmd_buffer, frame_data->meshlet_draw_buffer, 0, frame_data->meshlet_task_buffer, offsetof(MeshletTasks, draw_count),
+            r_chunk->meshlet_draw_count, sizeof(VkDrawIndexedIndirectCommand));
+        stats->draw_calls++;
+    }
 
-    command_buffer_submit(p_window, &cmd_buffer, VK_NULL_HANDLE);
-    CRASH_COND_MSG(vkQueueWaitIdle(p_window->vk_queue) != VK_SUCCESS, "%s", "FATAL: Failed to wait for queue!");
-    command_bufffer_free(p_vk_renderer, p_window, &cmd_buffer);
+    if (r_chunk->gpu_culling) {
+        for (size_t run = r_chunk->run_first; run < r_chunk->run_last;) {
+            const uint32_t count = SDL_min(r_chunk->run_last - run, renderer->max_draw_indirect_count);
+            vkCmdDrawIndexedIndirect(cmd_buffer, frame_data->draw_buffer, sizeof(VkDrawIndexedIndirectCommand) * run, count, sizeof(VkDrawIndexedIndirectCommand));
+            stats->draw_calls++;
+            run += count;
+        }
+    } else {
+        size_t first = r_chunk->run_first > 0 ? run_ends[r_chunk->run_first - 1] : 0;
+        for (size_t run = r_chunk->run_first; run < r_chunk->run_last; run++) {
+            const Mesh *mesh = objects_data[draw_objects[first]].surface.mesh;
+            const MeshLod *lod = &mesh->lods[r_chunk->lods[draw_objects[first]]];
+            vkCmdDrawIndexed(cmd_buffer, lod->index_count, run_ends[run] - first, lod->first_index, mesh->vertex_offset, first);
+            stats->draw_calls++;
+            first = run_ends[run];
+        }
+    }
 
-    // Free memory
-    vkDestroyBuffer(p_window->vk_device, staging_buffer, NULL);
-    vkFreeMemory(p_window->vk_device, staging_buffer_memory, NULL);
+    CRASH_COND_MSG(vkEndCommandBuffer(cmd_buffer) != VK_SUCCESS, "%s", "FATAL: Failed to end record command buffer!");
+}
+
+static void record_chunks_job(void *p_chunks, size_t p_begin, size_t p_end) {
+    RecordChunk *chunks = p_chunks;
+    for (size_t i = p_begin; i < p_end; i++) {
+        record_chunk(&chunks[i]);
+    }
+}
+
+/// Frame jobs
+
+// Shared by the parallel_for passes of vk_draw_frame, each pass writes only its own ranges.
+typedef struct FrameJobData {
+    const Object *objects_data;
+    size_t object_count;
+    Mat4 *models;
+    float *bounds; // Structure of arrays, center x, y, z then extent x, y, z
+    const Frustum *frustum;
+    uint8_t *visible;
+    const uint32_t *draw_objects;
+    const uint8_t *lods;
+    const size_t *run_ends;
+    InstanceData *instance_data;
+    CullObject *cull_objects;
+    VkDrawIndexedIndirectCommand *draws;
+    bool meshlet_culling;
+} FrameJobData;
+
+static void frame_bounds_job(void *p_data, size_t p_begin, size_t p_end) {
+    const FrameJobData *data = p_data;
+    const size_t object_count = data->object_count;
+    float *bounds = data->bounds;
+    for (size_t i = p_begin; i < p_end; i++) {
+        object_get_bias(&data->objects_data[i], data->models[i]);
+
+        Vect3 center, extent;
+        aabb_transform(&data->objects_data[i].surface.mesh->bounds, data->models[i], &center, &extent);
+        bounds[i] = center.x;
+        bounds[object_count + i] = center.y;
+        bounds[object_count * 2 + i] = center.z;
+        bounds[object_count * 3 + i] = extent.x;
+        bounds[object_count * 4 + i] = extent.y;
+        bounds[object_count * 5 + i] = extent.z;
+    }
+}
+
+static void frame_frustum_job(void *p_data, size_t p_begin, size_t p_end) {
+    const FrameJobData *data = p_data;
+    const size_t object_count = data->object_count;
+    const float *bounds = data->bounds + p_begin;
+    frustum_cull_aabbs(data->frustum, &(AabbArrays){
+        bounds,
+        bounds + object_count,
+        bounds + object_count * 2,
+        bounds + object_count * 3,
+        bounds + object_count * 4,
+        bounds + object_count * 5,
+    }, p_end - p_begin, data->visible + p_begin);
+}
+
+static void frame_instance_job(void *p_data, size_t p_begin, size_t p_end) {
+    const FrameJobData *data = p_data;
+    for (size_t i = p_begin; i < p_end; i++) {
+        // Built on the stack, the mapped memory may be write combined
+        const size_t object = data->draw_objects[i];
+        InstanceData instance = { .texture = data->objects_data[object].surface.texture->index };
+        memcpy(instance.model, data->models[object], sizeof(Mat4));
+        mat4_normal_matrix(instance.model, instance.normal);
+        data->instance_data[i] = instance;
+    }
+}
+
+// Every run starts empty at its own slice of the instance buffer, runs of levels with meshlets stay
+// empty and are drawn by the meshlet pass.
+static void frame_cull_objects_job(void *p_data, size_t p_begin, size_t p_end) {
+    const FrameJobData *data = p_data;
+    const size_t object_count = data->object_count;
+    const float *bounds = data->bounds;
+    for (size_t run = p_begin; run < p_end; run++) {
+        const size_t first = run > 0 ? data->run_ends[run - 1] : 0;
+        const Mesh *mesh = data->objects_data[data->draw_objects[first]].surface.mesh;
+        const MeshLod *lod = &mesh->lods[data->lods[data->draw_objects[first]]];
+        const uint32_t meshlet_count = data->meshlet_culling ? lod->meshlet_count : 0;
+        data->draws[run] = (VkDrawIndexedIndirectCommand) {
+            .indexCount = lod->index_count,
+            .instanceCount = 0,
+            .firstIndex = lod->first_index,
+            .vertexOffset = mesh->vertex_offset,
+            .firstInstance = first,
+        };
+
+        for (size_t i = first; i < data->run_ends[run]; i++) {
+            const size_t object = data->draw_objects[i];
+            const Vect3 extent = { bounds[object_count * 3 + object], bounds[object_count * 4 + object], bounds[object_count * 5 + object] };
+
+            // Built on the stack, the mapped memory may be write combined
+            CullObject cull_object = {
+                .instance = { .texture = data->objects_data[object].surface.texture->index },
+                .sphere = { .x = bounds[object], .y = bounds[object_count + object], .z = bounds[object_count * 2 + object], .w = sqrtf(vect3_dot(extent, extent)) },
+                .draw = run,
+                .first_meshlet = lod->first_meshlet,
+                .meshlet_count = meshlet_count,
+            };
+            memcpy(cull_object.instance.model, data->models[object], sizeof(Mat4));
+            mat4_normal_matrix(cull_object.instance.model, cull_object.instance.normal);
+            data->cull_objects[i] = cull_object;
+        }
+    }
 }
 
 // Pipeline
@@ -256,6 +639,37 @@ void vk_renderer_create(VkRenderer *r_vk_renderer, const Window *p_window, size_
     // Default settings
     r_vk_renderer->frag_push_constants.lighting_enabled = true;
 
+    // Draws with a non zero firstInstance read from the indirect buffer
+    VkPhysicalDeviceFeatures device_features;
+    vkGetPhysicalDeviceFeatures(p_window->vk_physical_device, &device_features);
+    r_vk_renderer->gpu_culling_supported = device_features.drawIndirectFirstInstance;
+    r_vk_renderer->gpu_culling = r_vk_renderer->gpu_culling_supported;
+    r_vk_renderer->lod_enabled = true;
+
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(p_window->vk_physical_device, &device_properties);
+    r_vk_renderer->max_draw_indirect_count = device_features.multiDrawIndirect ? device_properties.limits.maxDrawIndirectCount : 1;
+
+    // Meshlet draws are compacted on the GPU, only it knows how many there are
+    r_vk_renderer->meshlet_culling_supported = r_vk_renderer->gpu_culling_supported && p_window->draw_indirect_count && device_features.multiDrawIndirect;
+    r_vk_renderer->meshlet_culling = r_vk_renderer->meshlet_culling_supported;
+
+    // The texture array is only limited by the update after bind limits, which are far above the regular ones
+    VkPhysicalDeviceVulkan12Properties vulkan12_properties = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES };
+    vkGetPhysicalDeviceProperties2(p_window->vk_physical_device, &(VkPhysicalDeviceProperties2) {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &vulkan12_properties,
+    });
+    r_vk_renderer->texture_capacity = SDL_min(TEXTURE_MAX_COUNT, SDL_min(vulkan12_properties.maxPerStageDescriptorUpdateAfterBindSamplers, vulkan12_properties.maxPerStageDescriptorUpdateAfterBindSampledImages));
+    r_vk_renderer->texture_capacity = SDL_min(r_vk_renderer->texture_capacity, SDL_min(vulkan12_properties.maxDescriptorSetUpdateAfterBindSamplers, vulkan12_properties.maxDescriptorSetUpdateAfterBindSampledImages));
+    r_vk_renderer->texture_count = 0;
+    r_vk_renderer->free_texture_indices = (U32Vector){ 0 };
+
+    gpu_allocator_init(&r_vk_renderer->gpu_allocator, p_window->vk_physical_device, p_window->vk_device);
+    r_vk_renderer->texture_cache = hashmap_create(sizeof(Texture *));
+    r_vk_renderer->next_sort_id = 0;
+    r_vk_renderer->draw_stats = (DrawStats){ 0 };
+
     // Create command pool
     CRASH_COND_MSG(vkCreateCommandPool(p_window->vk_device,
         &(VkCommandPoolCreateInfo){
@@ -266,6 +680,27 @@ void vk_renderer_create(VkRenderer *r_vk_renderer, const Window *p_window, size_
         NULL, &r_vk_renderer->command_pool) != VK_SUCCESS,
         "%s", "FATAL: Failed to create command pool");
 
+    // Same family as command_pool when there is no dedicated transfer queue
+    CRASH_COND_MSG(vkCreateCommandPool(p_window->vk_device,
+        &(VkCommandPoolCreateInfo){
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            .queueFamilyIndex = p_window->vk_transfer_queue_index,
+        },
+        NULL, &r_vk_renderer->transfer_command_pool) != VK_SUCCESS,
+        "%s", "FATAL: Failed to create transfer command pool");
+
+    staging_ring_init(&r_vk_renderer->staging_ring, &r_vk_renderer->gpu_allocator, r_vk_renderer->transfer_command_pool, STAGING_RING_SIZE);
+    r_vk_renderer->upload_batch = (UploadBatch){ 0 };
+    r_vk_renderer->upload_acquire = (UploadAcquire){ 0 };
+
+    geometry_buffer_init(r_vk_renderer, p_window, &r_vk_renderer->vertex_geometry, GEOMETRY_VERTEX_CAPACITY, sizeof(Vertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    geometry_buffer_init(r_vk_renderer, p_window, &r_vk_renderer->index_geometry, GEOMETRY_INDEX_CAPACITY, sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    geometry_buffer_init(r_vk_renderer, p_window, &r_vk_renderer->meshlet_geometry, GEOMETRY_MESHLET_CAPACITY, sizeof(Meshlet), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+    // The job system must already be running
+    r_vk_renderer->record_count = job_system_thread_count();
+
     // ALlocate per FrameData
     r_vk_renderer->current_frame = 0;
     r_vk_renderer->frames = p_frame_count;
@@ -295,56 +730,194 @@ void vk_renderer_create(VkRenderer *r_vk_renderer, const Window *p_window, size_
             "%s", "FATAL: Failed to create frame fence!");
 
         command_bufffer_create(r_vk_renderer, p_window, &r_vk_renderer->frame_data[i].command_buffer);
+
+        // Pools are reset whole by the thread recording into them
+        r_vk_renderer->frame_data[i].record_pools = mmalloc(sizeof(VkCommandPool) * r_vk_renderer->record_count);
+        r_vk_renderer->frame_data[i].record_command_buffers = mmalloc(sizeof(VkCommandBuffer) * r_vk_renderer->record_count);
+        for (uint32_t j = 0; j < r_vk_renderer->record_count; j++) {
+            CRASH_COND_MSG(vkCreateCommandPool(p_window->vk_device,
+                &(VkCommandPoolCreateInfo){
+                    .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                    .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+                    .queueFamilyIndex = p_window->vk_queue_index,
+                },
+                NULL, &r_vk_renderer->frame_data[i].record_pools[j]) != VK_SUCCESS,
+                "%s", "FATAL: Failed to create record command pool");
+
+            CRASH_COND_MSG(vkAllocateCommandBuffers(p_window->vk_device,
+                &(VkCommandBufferAllocateInfo) {
+                    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                    .commandPool = r_vk_renderer->frame_data[i].record_pools[j],
+                    .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+                    .commandBufferCount = 1,
+                },
+                &r_vk_renderer->frame_data[i].record_command_buffers[j]) != VK_SUCCESS,
+                "%s", "FATAL: Failed to create record command buffer!");
+        }
+
+        r_vk_renderer->frame_data[i].instance_capacity = 0;
+        r_vk_renderer->frame_data[i].cull_object_capacity = 0;
+        r_vk_renderer->frame_data[i].draw_capacity = 0;
+        r_vk_renderer->frame_data[i].meshlet_task_capacity = 0;
+        r_vk_renderer->frame_data[i].meshlet_draw_capacity = 0;
+        r_vk_renderer->frame_data[i].cull_set_dirty = false;
+        r_vk_renderer->frame_data[i].retired_vertices = (RangeVector){ 0 };
+        r_vk_renderer->frame_data[i].retired_indices = (RangeVector){ 0 };
+        r_vk_renderer->frame_data[i].retired_meshlets = (RangeVector){ 0 };
+        r_vk_renderer->frame_data[i].retired_textures = (RetiredTextureVector){ 0 };
+        r_vk_renderer->frame_data[i].wait_semaphores = (VkSemaphoreVector){ 0 };
+        r_vk_renderer->frame_data[i].wait_stages = (U32Vector){ 0 };
+        vk_semaphore_vector_push_back(&r_vk_renderer->frame_data[i].wait_semaphores, r_vk_renderer->frame_data[i].image_available);
+        u32_vector_push_back(&r_vk_renderer->frame_data[i].wait_stages, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
     };
 
     // Create descriptor set layouts
     CRASH_COND_MSG(vkCreateDescriptorSetLayout(p_window->vk_device, &(VkDescriptorSetLayoutCreateInfo) {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-        .bindingCount = 2,
-        .pBindings = (VkDescriptorSetLayoutBinding[]) {
-            {
-                .binding = 0,
-                .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                .descriptorCount = 1,
-                .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
-                .pImmutableSamplers = NULL,
-            },
-            {
-                .binding = 1,
-                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .descriptorCount = 1,
-                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
-                .pImmutableSamplers = NULL,
+        .bindingCount = 1,
+        .pBindings = &(VkDescriptorSetLayoutBinding) {
+            .binding = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+            .pImmutableSamplers = NULL,
+        },
+    },
+    NULL, &r_vk_renderer->frame_set_layout) != VK_SUCCESS,
+    "%s", "FATAL: Failed to create frame descriptor set layout");
+
+    // Slots are written while frames using other slots are in flight, unused ones are never written
+    CRASH_COND_MSG(vkCreateDescriptorSetLayout(p_window->vk_device, &(VkDescriptorSetLayoutCreateInfo) {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = &(VkDescriptorSetLayoutBindingFlagsCreateInfo) {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+            .bindingCount = 1,
+            .pBindingFlags = &(VkDescriptorBindingFlags) {
+                VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
             },
         },
+        .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+        .bindingCount = 1,
+        .pBindings = &(VkDescriptorSetLayoutBinding) {
+            .binding = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = r_vk_renderer->texture_capacity,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .pImmutableSamplers = NULL,
+        },
     },
-    NULL, &r_vk_renderer->descriptor_set) != VK_SUCCESS,
-    "%s", "FATAL: Failed to create descriptor set layout");
+    NULL, &r_vk_renderer->texture_set_layout) != VK_SUCCESS,
+    "%s", "FATAL: Failed to create texture descriptor set layout");
+
+    // Objects, draws and the compacted instances of shaders/cull_shader.comp, then the meshlet tasks,
+    // meshlets and meshlet draws of shaders/meshlet_cull_shader.comp, see frame_cull_reserve
+    VkDescriptorSetLayoutBinding cull_bindings[CULL_BINDING_COUNT];
+    for (uint32_t i = 0; i < CULL_BINDING_COUNT; i++) {
+        cull_bindings[i] = (VkDescriptorSetLayoutBinding) {
+            .binding = i,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL,
+        };
+    }
+    CRASH_COND_MSG(vkCreateDescriptorSetLayout(p_window->vk_device, &(VkDescriptorSetLayoutCreateInfo) {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = CULL_BINDING_COUNT,
+        .pBindings = cull_bindings,
+    },
+    NULL, &r_vk_renderer->cull_set_layout) != VK_SUCCESS,
+    "%s", "FATAL: Failed to create cull descriptor set layout");
 
     // Create pool for DescriptorSetLayout
     CRASH_COND_MSG(vkCreateDescriptorPool(p_window->vk_device,
         &(VkDescriptorPoolCreateInfo) {
             .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
             .poolSizeCount = 2,
             .pPoolSizes = (VkDescriptorPoolSize[]) {
                 {
                     .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                    .descriptorCount = 1000,
+                    .descriptorCount = p_frame_count,
                 },
                 {
-                    .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                    .descriptorCount = 1000,
+                    .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                    .descriptorCount = p_frame_count * CULL_BINDING_COUNT,
                 },
             },
-            .maxSets = 10000,
+            .maxSets = p_frame_count * 2,
         }, NULL, &r_vk_renderer->descriptor_pool) != VK_SUCCESS,
         "%s", "Failed to create descriptor set pool");
 
+    // The one texture set, its size no longer grows with the scene
+    CRASH_COND_MSG(vkCreateDescriptorPool(p_window->vk_device,
+        &(VkDescriptorPoolCreateInfo) {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+            .poolSizeCount = 1,
+            .pPoolSizes = &(VkDescriptorPoolSize) {
+                .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .descriptorCount = r_vk_renderer->texture_capacity,
+            },
+            .maxSets = 1,
+        }, NULL, &r_vk_renderer->texture_descriptor_pool) != VK_SUCCESS,
+        "%s", "Failed to create texture descriptor pool");
+
+    CRASH_COND_MSG(vkAllocateDescriptorSets(p_window->vk_device, &(VkDescriptorSetAllocateInfo) {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .descriptorPool = r_vk_renderer->texture_descriptor_pool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &r_vk_renderer->texture_set_layout,
+        }, &r_vk_renderer->texture_set) != VK_SUCCESS,
+        "%s", "FATAL: Failed to allocate texture DescriptorSet!");
+
+    // Per frame camera buffers, set 0
+    for (size_t i = 0; i < p_frame_count; i++) {
+        FrameData *frame_data = &r_vk_renderer->frame_data[i];
+        memory_create_vkbuffer(&r_vk_renderer->gpu_allocator, p_window->vk_device, sizeof(CameraBuffer), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &frame_data->camera_buffer, &frame_data->camera_memory);
+
+        CRASH_COND_MSG(vkAllocateDescriptorSets(p_window->vk_device, &(VkDescriptorSetAllocateInfo) {
+                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                .descriptorPool = r_vk_renderer->descriptor_pool,
+                .descriptorSetCount = 1,
+                .pSetLayouts = &r_vk_renderer->frame_set_layout,
+            }, &frame_data->camera_descriptor_set) != VK_SUCCESS,
+            "%s", "FATAL: Failed to allocate frame DescriptorSet!");
+
+        vkUpdateDescriptorSets(p_window->vk_device, 1, &(VkWriteDescriptorSet) {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = frame_data->camera_descriptor_set,
+            .dstBinding = 0,
+            .dstArrayElement = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorCount = 1,
+            .pBufferInfo = &(VkDescriptorBufferInfo) {
+                .buffer = frame_data->camera_buffer,
+                .offset = 0,
+                .range = sizeof(CameraBuffer),
+            },
+            .pImageInfo = NULL,
+            .pTexelBufferView = NULL,
+        }, 0, NULL);
+
+        // Written once the cull buffers exist, see frame_cull_reserve
+        CRASH_COND_MSG(vkAllocateDescriptorSets(p_window->vk_device, &(VkDescriptorSetAllocateInfo) {
+                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                .descriptorPool = r_vk_renderer->descriptor_pool,
+                .descriptorSetCount = 1,
+                .pSetLayouts = &r_vk_renderer->cull_set_layout,
+            }, &frame_data->cull_descriptor_set) != VK_SUCCESS,
+            "%s", "FATAL: Failed to allocate cull DescriptorSet!");
+    }
+
     // Create pipeline layout
     CRASH_COND_MSG(vkCreatePipelineLayout(p_window->vk_device, &(VkPipelineLayoutCreateInfo) {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-            .setLayoutCount = 1,
-            .pSetLayouts = &r_vk_renderer->descriptor_set,
+            .setLayoutCount = 2,
+            .pSetLayouts = (VkDescriptorSetLayout[]) {
+                r_vk_renderer->frame_set_layout,
+                r_vk_renderer->texture_set_layout,
+            },
             .pushConstantRangeCount = 1,
             .pPushConstantRanges = (VkPushConstantRange[]) {
                 {
@@ -356,6 +929,21 @@ void vk_renderer_create(VkRenderer *r_vk_renderer, const Window *p_window, size_
         }, NULL, &r_vk_renderer->pipeline_layout) != VK_SUCCESS,
         "%s", "FATAL: Failed tp create pipeline layout");
 
+    CRASH_COND_MSG(vkCreatePipelineLayout(p_window->vk_device, &(VkPipelineLayoutCreateInfo) {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+            .setLayoutCount = 1,
+            .pSetLayouts = &r_vk_renderer->cull_set_layout,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = (VkPushConstantRange[]) {
+                {
+                    .offset = 0,
+                    .size = sizeof(CullPushConstants),
+                    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                }
+            },
+        }, NULL, &r_vk_renderer->cull_pipeline_layout) != VK_SUCCESS,
+        "%s", "FATAL: Failed to create cull pipeline layout");
+
     // Create renderpass
     CRASH_COND_MSG(vkCreateRenderPass(p_window->vk_device,
         &(VkRenderPassCreateInfo) {
@@ -429,7 +1017,11 @@ void vk_renderer_create(VkRenderer *r_vk_renderer, const Window *p_window, size_
         }, NULL, &r_vk_renderer->depth_texture.image) != VK_SUCCESS,
         "%s", "FATAL: failed to create depth image");
 
-    memory_create_image_buffer(p_window->vk_device, p_window->vk_physical_device, r_vk_renderer->depth_texture.image, &r_vk_renderer->depth_texture.device_memory);
+    memory_create_image_buffer(&r_vk_renderer->gpu_allocator, p_window->vk_device, r_vk_renderer->depth_texture.image, &r_vk_renderer->depth_texture.memory);
+    r_vk_renderer->depth_texture.index = TEXTURE_NO_INDEX;
+    r_vk_renderer->depth_texture.path = NULL;
+    r_vk_renderer->depth_texture.ref_count = 1;
+    r_vk_renderer->depth_texture.sort_id = 0;
 
     CRASH_COND_MSG(vkCreateImageView(p_window->vk_device,
         &(VkImageViewCreateInfo) {
@@ -489,13 +1081,20 @@ void vk_renderer_create(VkRenderer *r_vk_renderer, const Window *p_window, size_
         },
         .pVertexInputState = &(VkPipelineVertexInputStateCreateInfo){
             .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-            .vertexBindingDescriptionCount = 1,
-            .pVertexBindingDescriptions = &(VkVertexInputBindingDescription) {
-                .binding = 0,
-                .stride = sizeof(Vertex),
-                .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+            .vertexBindingDescriptionCount = 2,
+            .pVertexBindingDescriptions = (VkVertexInputBindingDescription[]) {
+                {
+                    .binding = 0,
+                    .stride = sizeof(Vertex),
+                    .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+                },
+                {
+                    .binding = 1,
+                    .stride = sizeof(InstanceData),
+                    .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE,
+                },
             },
-            .vertexAttributeDescriptionCount = 4,
+            .vertexAttributeDescriptionCount = 12,
             .pVertexAttributeDescriptions = (VkVertexInputAttributeDescription[]) {
                 {
                     .binding = 0,
@@ -521,6 +1120,54 @@ void vk_renderer_create(VkRenderer *r_vk_renderer, const Window *p_window, size_
                     .format = VK_FORMAT_R32G32_SFLOAT,
                     .offset = offsetof(Vertex, tex_coord),
                 },
+                {
+                    .binding = 1,
+                    .location = 4,
+                    .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+                    .offset = offsetof(InstanceData, model),
+                },
+                {
+                    .binding = 1,
+                    .location = 5,
+                    .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+                    .offset = offsetof(InstanceData, model) + sizeof(float) * 4,
+                },
+                {
+                    .binding = 1,
+                    .location = 6,
+                    .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+                    .offset = offsetof(InstanceData, model) + sizeof(float) * 8,
+                },
+                {
+                    .binding = 1,
+                    .location = 7,
+                    .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+                    .offset = offsetof(InstanceData, model) + sizeof(float) * 12,
+                },
+                {
+                    .binding = 1,
+                    .location = 8,
+                    .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+                    .offset = offsetof(InstanceData, normal),
+                },
+                {
+                    .binding = 1,
+                    .location = 9,
+                    .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+                    .offset = offsetof(InstanceData, normal) + sizeof(float) * 4,
+                },
+                {
+                    .binding = 1,
+                    .location = 10,
+                    .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+                    .offset = offsetof(InstanceData, normal) + sizeof(float) * 8,
+                },
+                {
+                    .binding = 1,
+                    .location = 11,
+                    .format = VK_FORMAT_R32_UINT,
+                    .offset = offsetof(InstanceData, texture),
+                },
             },
         },
         .pInputAssemblyState = &(VkPipelineInputAssemblyStateCreateInfo) {
@@ -537,8 +1184,8 @@ void vk_renderer_create(VkRenderer *r_vk_renderer, const Window *p_window, size_
             .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
             .depthClampEnable = VK_FALSE,
             .polygonMode = VK_POLYGON_MODE_FILL,
-            .cullMode = VK_CULL_MODE_NONE,
-            .frontFace = VK_FRONT_FACE_CLOCKWISE,
+            .cullMode = VK_CULL_MODE_BACK_BIT,
+            .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE, // The winding of the meshes, the flipped y of the projection keeps it
             .depthBiasEnable = VK_FALSE,
             .depthBiasConstantFactor = 0.0,
             .depthBiasClamp = 0.0,
@@ -602,6 +1249,40 @@ void vk_renderer_create(VkRenderer *r_vk_renderer, const Window *p_window, size_
     }, NULL, &r_vk_renderer->pipeline) != VK_SUCCESS,
     "%s", "FATAL: Failed to create pipeline!");
 
+    get_resource_path(shader_path, "shaders/cull_shader.spv");
+    pipeline_create_shader_module(p_window->vk_device, shader_path, &r_vk_renderer->cull_shader_module);
+
+    CRASH_COND_MSG(vkCreateComputePipelines(p_window->vk_device, VK_NULL_HANDLE, 1, &(VkComputePipelineCreateInfo){
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = r_vk_renderer->cull_shader_module,
+            .pName = "main",
+        },
+        .layout = r_vk_renderer->cull_pipeline_layout,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1,
+    }, NULL, &r_vk_renderer->cull_pipeline) != VK_SUCCESS,
+    "%s", "FATAL: Failed to create cull pipeline!");
+
+    get_resource_path(shader_path, "shaders/meshlet_cull_shader.spv");
+    pipeline_create_shader_module(p_window->vk_device, shader_path, &r_vk_renderer->meshlet_cull_shader_module);
+
+    CRASH_COND_MSG(vkCreateComputePipelines(p_window->vk_device, VK_NULL_HANDLE, 1, &(VkComputePipelineCreateInfo){
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = r_vk_renderer->meshlet_cull_shader_module,
+            .pName = "main",
+        },
+        .layout = r_vk_renderer->cull_pipeline_layout,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1,
+    }, NULL, &r_vk_renderer->meshlet_cull_pipeline) != VK_SUCCESS,
+    "%s", "FATAL: Failed to create meshlet cull pipeline!");
+
     // Create other configuration types
     CRASH_COND_MSG(vkCreateSampler(p_window->vk_device, &(VkSamplerCreateInfo) {
         .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
@@ -638,20 +1319,286 @@ void vk_renderer_create(VkRenderer *r_vk_renderer, const Window *p_window, size_
     };
 }
 
-void vk_draw_frame(VkRenderer *p_vk_renderer, const Window *p_window, Camera *camera, const Vector *objects) {
+// Only called once the frame fence signaled, so the old buffer is no longer read.
+// Returns true when the buffer was replaced.
+static bool frame_buffer_reserve(VkRenderer *r_vk_renderer, const Window *p_window, VkBuffer *r_buffer, GpuAllocation *r_memory, size_t *r_capacity, size_t p_count, size_t p_stride, VkBufferUsageFlags p_usage) {
+    if (p_count <= *r_capacity) {
+        return false;
+    }
+
+    if (*r_capacity > 0) {
+        memory_free_vkbuffer(&r_vk_renderer->gpu_allocator, p_window->vk_device, *r_buffer, r_memory);
+    }
+
+    size_t capacity = *r_capacity == 0 ? 64 : *r_capacity * 2;
+    while (capacity < p_count) {
+        capacity *= 2;
+    }
+    memory_create_vkbuffer(&r_vk_renderer->gpu_allocator, p_window->vk_device, p_stride * capacity, p_usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, r_buffer, r_memory);
+    *r_capacity = capacity;
+    return true;
+}
+
+static void frame_instance_reserve(VkRenderer *r_vk_renderer, const Window *p_window, FrameData *r_frame_data, size_t p_count) {
+    if (frame_buffer_reserve(r_vk_renderer, p_window, &r_frame_data->instance_buffer, &r_frame_data->instance_memory, &r_frame_data->instance_capacity, p_count,
+            sizeof(InstanceData), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+        r_frame_data->cull_set_dirty = true;
+    }
+}
+
+// Grows the culling buffers and rewrites the cull descriptor set when any of them, the
+// instance buffer included, was replaced since it was last written. The meshlet buffers
+// always exist, the set is complete even on frames without meshlets.
+static void frame_cull_reserve(VkRenderer *r_vk_renderer, const Window *p_window, FrameData *r_frame_data, size_t p_object_count, size_t p_draw_count, size_t p_meshlet_object_count, size_t p_meshlet_count) {
+    frame_instance_reserve(r_vk_renderer, p_window, r_frame_data, p_object_count);
+    r_frame_data->cull_set_dirty |= frame_buffer_reserve(r_vk_renderer, p_window, &r_frame_data->cull_object_buffer, &r_frame_data->cull_object_memory, &r_frame_data->cull_object_capacity, p_object_count,
+        sizeof(CullObject), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    r_frame_data->cull_set_dirty |= frame_buffer_reserve(r_vk_renderer, p_window, &r_frame_data->draw_buffer, &r_frame_data->draw_memory, &r_frame_data->draw_capacity, p_draw_count,
+        sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    r_frame_data->cull_set_dirty |= frame_buffer_reserve(r_vk_renderer, p_window, &r_frame_data->meshlet_task_buffer, &r_frame_data->meshlet_task_memory, &r_frame_data->meshlet_task_capacity,
+        sizeof(MeshletTasks) / sizeof(uint32_t) + p_meshlet_object_count, sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    r_frame_data->cull_set_dirty |= frame_buffer_reserve(r_vk_renderer, p_window, &r_frame_data->meshlet_draw_buffer, &r_frame_data->meshlet_draw_memory, &r_frame_data->meshlet_draw_capacity,
+        SDL_max(p_meshlet_count, 1), sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    if (!r_frame_data->cull_set_dirty) {
+        return;
+    }
+    r_frame_data->cull_set_dirty = false;
+
+    const VkBuffer buffers[CULL_BINDING_COUNT] = {
+        r_frame_data->cull_object_buffer,
+        r_frame_data->draw_buffer,
+        r_frame_data->instance_buffer,
+        r_frame_data->meshlet_task_buffer,
+        r_vk_renderer->meshlet_geometry.buffer,
+        r_frame_data->meshlet_draw_buffer,
+    };
+    VkDescriptorBufferInfo buffer_infos[CULL_BINDING_COUNT];
+    VkWriteDescriptorSet writes[CULL_BINDING_COUNT];
+    for (uint32_t i = 0; i < CULL_BINDING_COUNT; i++) {
+        buffer_infos[i] = (VkDescriptorBufferInfo) {
+            .buffer = buffers[i],
+            .offset = 0,
+            .range = VK_WHOLE_SIZE,
+        };
+        writes[i] = (VkWriteDescriptorSet) {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = r_frame_data->cull_descriptor_set,
+            .dstBinding = i,
+            .dstArrayElement = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .pBufferInfo = &buffer_infos[i],
+            .pImageInfo = NULL,
+            .pTexelBufferView = NULL,
+        };
+    }
+    vkUpdateDescriptorSets(p_window->vk_device, CULL_BINDING_COUNT, writes, 0, NULL);
+}
+
+void vk_draw_frame(VkRenderer *p_vk_renderer, const Window *p_window, Camera *camera, const SlotMap *objects, Arena *r_frame_arena) {
     size_t frame = p_vk_renderer->current_frame;
 
     // Wait for previous frame
     CRASH_COND_MSG(vkWaitForFences(p_window->vk_device, 1, &p_vk_renderer->frame_data[frame].render_fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS, "%s", "FATAL: Failed to wait for frame!");
     CRASH_COND_MSG(vkResetFences(p_window->vk_device, 1, &p_vk_renderer->frame_data[frame].render_fence) != VK_SUCCESS, "%s", "FATAL: Failed to reset frame fence!");
+    staging_ring_reclaim(&p_vk_renderer->staging_ring);
+    frame_release_retired(p_vk_renderer, p_window, &p_vk_renderer->frame_data[frame]);
+
+    // Upload semaphores waited on by this frame can be signaled again
+    VkSemaphoreVector *wait_semaphores = &p_vk_renderer->frame_data[frame].wait_semaphores;
+    vk_semaphore_vector_append_range(&p_vk_renderer->upload_acquire.free_semaphores, wait_semaphores->data + 1, wait_semaphores->size - 1);
+    wait_semaphores->size = 1;
+    p_vk_renderer->frame_data[frame].wait_stages.size = 1;
 
     // Get next image
     uint32_t image_idx;
     CRASH_COND_MSG(vkAcquireNextImageKHR(p_window->vk_device, p_window->vk_swapchain, UINT64_MAX, p_vk_renderer->frame_data[frame].image_available, VK_NULL_HANDLE, &image_idx) != VK_SUCCESS,
         "%s", "FATAL: Failed to get frame image index!");
 
-    const VkCommandBuffer cmd_buffer = p_vk_renderer->frame_data[frame].command_buffer;
+    FrameData *frame_data = &p_vk_renderer->frame_data[frame];
+    const VkCommandBuffer cmd_buffer = frame_data->command_buffer;
     command_buffer_start(&cmd_buffer, 0);
+    upload_acquire_record(p_vk_renderer, cmd_buffer, frame_data);
+
+    // Create CameraBuffer
+    CameraBuffer camera_bufffer = { .proj = { {0},{0},{0},{0} }};
+
+    // Compute camera view
+    camera_get_bias(camera, camera_bufffer.view);
+    const float z_near = 0.1f;
+    const float z_far = 100.0f;
+    mat4_perspective(camera_bufffer.proj, degtorad(60), p_window->vk_extent2D.width / p_window->vk_extent2D.height, z_near, z_far);
+    camera_bufffer.proj[1][1] *= -1;
+    memcpy(frame_data->camera_memory.mapped, &camera_bufffer, sizeof(CameraBuffer));
+
+    // Frustum of the matrices the shader uses
+    Mat4 view_proj;
+    memcpy(view_proj, camera_bufffer.view, sizeof(Mat4));
+    mat4_multi(view_proj, camera_bufffer.proj);
+    Frustum frustum;
+    frustum_from_matrix(&frustum, view_proj);
+
+    // Inverse of the view's rigid transform, its rotation is orthonormal so the inverse is the transpose
+    Vect4 eye = { .w = 1.0f };
+    float *eye_axes[3] = { &eye.x, &eye.y, &eye.z };
+    for (int i = 0; i < 3; i++) {
+        *eye_axes[i] = -(camera_bufffer.view[i][0] * camera_bufffer.view[3][0] + camera_bufffer.view[i][1] * camera_bufffer.view[3][1] + camera_bufffer.view[i][2] * camera_bufffer.view[3][2]);
+    }
+
+    // World space boxes of every object
+    const size_t object_count = slot_map_size(objects);
+    const Object *objects_data = slot_map_dense(objects);
+    Mat4 *models = arena_alloc(r_frame_arena, sizeof(Mat4) * object_count);
+    float *bounds = arena_alloc(r_frame_arena, sizeof(float) * 6 * object_count);
+    FrameJobData job_data = {
+        .objects_data = objects_data,
+        .object_count = object_count,
+        .models = models,
+        .bounds = bounds,
+        .frustum = &frustum,
+    };
+    parallel_for(object_count, DRAW_MIN_OBJECTS_PER_JOB, frame_bounds_job, &job_data);
+
+    // The compute pass sees every object, the CPU path only the ones inside the frustum
+    const bool gpu_culling = p_vk_renderer->gpu_culling;
+    bool meshlet_culling = gpu_culling && p_vk_renderer->meshlet_culling;
+    uint8_t *visible = arena_alloc(r_frame_arena, object_count);
+    job_data.visible = visible;
+    if (gpu_culling) {
+        memset(visible, 1, object_count);
+    } else {
+        parallel_for(object_count, DRAW_MIN_OBJECTS_PER_JOB, frame_frustum_job, &job_data);
+    }
+
+    // Key every drawn object by state then depth, the clip w of its center is its view depth
+    const float pixels_per_unit = fabsf(camera_bufffer.proj[1][1]) * p_window->vk_extent2D.height * 0.5f;
+    size_t draw_count = 0;
+    uint64_t *draw_keys = arena_alloc(r_frame_arena, sizeof(uint64_t) * object_count);
+    uint32_t *draw_objects = arena_alloc(r_frame_arena, sizeof(uint32_t) * object_count);
+    uint8_t *lods = arena_alloc(r_frame_arena, object_count);
+    uint32_t triangles = 0;
+    uint32_t meshlet_objects = 0;
+    uint32_t meshlets = 0;
+    for (size_t i = 0; i < object_count; i++) {
+        if (!visible[i]) {
+            continue;
+        }
+        const float depth = view_proj[0][3] * bounds[i] + view_proj[1][3] * bounds[object_count + i] + view_proj[2][3] * bounds[object_count * 2 + i] + view_proj[3][3];
+
+        lods[i] = 0;
+        const Mesh *mesh = objects_data[i].surface.mesh;
+        if (p_vk_renderer->lod_enabled) {
+            const Vect3 extent = { bounds[object_count * 3 + i], bounds[object_count * 4 + i], bounds[object_count * 5 + i] };
+            lods[i] = draw_select_lod(mesh, SDL_max(depth - sqrtf(vect3_dot(extent, extent)), z_near), pixels_per_unit);
+        }
+        triangles += mesh->lods[lods[i]].index_count / 3;
+        if (meshlet_culling && mesh->lods[lods[i]].meshlet_count > 0) {
+            meshlet_objects++;
+            meshlets += mesh->lods[lods[i]].meshlet_count;
+        }
+
+        draw_keys[draw_count] = draw_key(DRAW_PIPELINE_OPAQUE, &objects_data[i].surface, lods[i], (depth - z_near) / (z_far - z_near));
+        draw_objects[draw_count] = i;
+        draw_count++;
+    }
+
+    // The meshlet draws are counted on the GPU and issued by one call, past its limit levels are drawn whole this frame
+    if (meshlets > p_vk_renderer->max_draw_indirect_count) {
+        meshlet_culling = false;
+        meshlet_objects = 0;
+        meshlets = 0;
+    }
+    radix_sort_u64(draw_keys, draw_objects, arena_alloc(r_frame_arena, sizeof(uint64_t) * draw_count), arena_alloc(r_frame_arena, sizeof(uint32_t) * draw_count), draw_count);
+
+    DrawStats *stats = &p_vk_renderer->draw_stats;
+    *stats = (DrawStats){ .objects = object_count, .instances = draw_count, .triangles = triangles, .meshlets = meshlets };
+
+    // One past the last instance of each run
+    size_t run_count = 0;
+    size_t *run_ends = arena_alloc(r_frame_arena, sizeof(size_t) * object_count);
+    for (size_t i = 1; i <= draw_count; i++) {
+        if (i == draw_count || !draw_same_batch(&objects_data[draw_objects[i - 1]].surface, lods[draw_objects[i - 1]], &objects_data[draw_objects[i]].surface, lods[draw_objects[i]])) {
+            run_ends[run_count++] = i;
+        }
+    }
+    stats->runs = run_count;
+    job_data.draw_objects = draw_objects;
+    job_data.lods = lods;
+    job_data.run_ends = run_ends;
+
+    if (draw_count > 0 && gpu_culling) {
+        frame_cull_reserve(p_vk_renderer, p_window, frame_data, draw_count, run_count, meshlet_objects, meshlets);
+
+        job_data.draws = frame_data->draw_memory.mapped;
+        job_data.cull_objects = frame_data->cull_object_memory.mapped;
+        job_data.meshlet_culling = meshlet_culling;
+        parallel_for(run_count, RECORD_MIN_RUNS_PER_CHUNK, frame_cull_objects_job, &job_data);
+        *(MeshletTasks *)frame_data->meshlet_task_memory.mapped = (MeshletTasks){ .dispatch = { 0, 1, 1 }, .draw_count = 0 };
+
+        CullPushConstants cull_push_constants = { .eye = eye, .object_count = draw_count };
+        memcpy(cull_push_constants.planes, frustum.planes, sizeof(frustum.planes));
+
+        vkCmdBindPipeline(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, p_vk_renderer->cull_pipeline);
+        vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, p_vk_renderer->cull_pipeline_layout, 0, 1, &frame_data->cull_descriptor_set, 0, NULL);
+        vkCmdPushConstants(cmd_buffer, p_vk_renderer->cull_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &cull_push_constants);
+        vkCmdDispatch(cmd_buffer, (draw_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+        if (meshlet_objects > 0) {
+            // One workgroup per visible object the first pass appended, same layout so the set and constants stay bound
+            vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                1, &(VkMemoryBarrier) {
+                    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                    .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+                    .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                }, 0, NULL, 0, NULL);
+            vkCmdBindPipeline(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, p_vk_renderer->meshlet_cull_pipeline);
+            vkCmdDispatchIndirect(cmd_buffer, frame_data->meshlet_task_buffer, offsetof(MeshletTasks, dispatch));
+        }
+
+        // Instance counts, the compacted instances and meshlet draws are read by the draws below
+        vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+            1, &(VkMemoryBarrier) {
+                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+            }, 0, NULL, 0, NULL);
+    } else if (draw_count > 0) {
+        frame_instance_reserve(p_vk_renderer, p_window, frame_data, draw_count);
+        job_data.instance_data = frame_data->instance_memory.mapped;
+        parallel_for(draw_count, DRAW_MIN_OBJECTS_PER_JOB, frame_instance_job, &job_data);
+    }
+
+    // Split the runs evenly, small draw lists stay on this thread
+    size_t chunk_count = SDL_min((run_count + RECORD_MIN_RUNS_PER_CHUNK - 1) / RECORD_MIN_RUNS_PER_CHUNK, p_vk_renderer->record_count);
+    RecordChunk *chunks = arena_alloc(r_frame_arena, sizeof(RecordChunk) * chunk_count);
+    for (size_t i = 0; i < chunk_count; i++) {
+        chunks[i] = (RecordChunk){
+            .renderer = p_vk_renderer,
+            .frame_data = frame_data,
+            .device = p_window->vk_device,
+            .command_pool = frame_data->record_pools[i],
+            .cmd_buffer = frame_data->record_command_buffers[i],
+            .framebuffer = p_vk_renderer->vk_frame_buffers[image_idx],
+            .objects_data = objects_data,
+            .draw_objects = draw_objects,
+            .lods = lods,
+            .run_ends = run_ends,
+            .run_first = run_count * i / chunk_count,
+            .run_last = run_count * (i + 1) / chunk_count,
+            .gpu_culling = gpu_culling,
+            .meshlet_draw_count = i == 0 ? meshlets : 0,
+        };
+    }
+
+    parallel_for(chunk_count, 1, record_chunks_job, chunks);
+
+    for (size_t i = 0; i < chunk_count; i++) {
+        stats->draw_calls += chunks[i].stats.draw_calls;
+        stats->pipeline_binds += chunks[i].stats.pipeline_binds;
+        stats->descriptor_set_binds += chunks[i].stats.descriptor_set_binds;
+        stats->vertex_buffer_binds += chunks[i].stats.vertex_buffer_binds;
+        stats->index_buffer_binds += chunks[i].stats.index_buffer_binds;
+    }
 
     vkCmdBeginRenderPass(cmd_buffer, &(VkRenderPassBeginInfo) {
         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
@@ -675,36 +1622,10 @@ void vk_draw_frame(VkRenderer *p_vk_renderer, const Window *p_window, Camera *ca
                 },
             },
         },
-    }, VK_SUBPASS_CONTENTS_INLINE);
-
-    vkCmdBindPipeline(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, p_vk_renderer->pipeline);
-    vkCmdSetViewport(cmd_buffer, 0, 1, &p_vk_renderer->vk_viewport);
-    vkCmdSetScissor(cmd_buffer, 0, 1, &p_vk_renderer->vk_scissor);
-
-    vkCmdPushConstants(cmd_buffer, p_vk_renderer->pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(FragPushConstants), &p_vk_renderer->frag_push_constants);
-
-    // Create CameraBuffer
-    CameraBuffer camera_bufffer = { .proj = { {0},{0},{0},{0} }};
-
-    // Compute camera view
-    camera_get_bias(camera, camera_bufffer.view);
-    mat4_perspective(camera_bufffer.proj, degtorad(60), p_window->vk_extent2D.width / p_window->vk_extent2D.height, 0.1, 100.0);
-    camera_bufffer.proj[1][1] *= -1;
-
-    // TODO: Should take surfaces?
-    for (size_t i = 0; i < objects->size; i++) {
-        Object object = *(Object *)vector_get(objects, i);
+    }, chunk_count > 0 ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
 
-        object_get_bias(&object, camera_bufffer.model);
-        SurfaceDescriptorSet surface_descriptor = *(SurfaceDescriptorSet *)vector_get(&object.surface.descriptor_sets, frame);
-        memcpy(surface_descriptor.camera_data, &camera_bufffer, sizeof(CameraBuffer));
-
-        vkCmdBindVertexBuffers(cmd_buffer, 0, 1, (VkBuffer[]){object.surface.vertex_buffer}, (VkDeviceSize[]){ 0 });
-
-        vkCmdBindIndexBuffer(cmd_buffer, object.surface.index_buffer, 0, VK_INDEX_TYPE_UINT32);
-        vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, p_vk_renderer->pipeline_layout, 0, 1, &surface_descriptor.descriptor_set, 0, NULL);
-
-        vkCmdDrawIndexed(cmd_buffer, object.surface.index_data.size, 1, 0, 0, 0);
+    if (chunk_count > 0) {
+        vkCmdExecuteCommands(cmd_buffer, chunk_count, frame_data->record_command_buffers);
     }
 
     vkCmdEndRenderPass(cmd_buffer);
@@ -712,13 +1633,9 @@ void vk_draw_frame(VkRenderer *p_vk_renderer, const Window *p_window, Camera *ca
     CRASH_COND_MSG(vkQueueSubmit(p_window->vk_queue, 1,
         &(VkSubmitInfo) {
             .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            .waitSemaphoreCount = 1,
-            .pWaitSemaphores = (VkSemaphore[]) {
-                p_vk_renderer->frame_data[frame].image_available,
-            },
-            .pWaitDstStageMask = (VkPipelineStageFlags[]) {
-                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
-            },
+            .waitSemaphoreCount = wait_semaphores->size,
+            .pWaitSemaphores = wait_semaphores->data,
+            .pWaitDstStageMask = p_vk_renderer->frame_data[frame].wait_stages.data,
             .commandBufferCount = 1,
             .pCommandBuffers = &cmd_buffer,
             .signalSemaphoreCount = 1,
@@ -748,28 +1665,98 @@ void vk_draw_frame(VkRenderer *p_vk_renderer, const Window *p_window, Camera *ca
 }
 
 void vk_renderer_free(VkRenderer *r_vk_renderer, const Window *p_window) {
+    // Upload semaphores may still be pending on either queue
+    vkDeviceWaitIdle(p_window->vk_device);
+
+    UploadAcquire *acquire = &r_vk_renderer->upload_acquire;
     for (size_t i = 0; i < r_vk_renderer->frames; i++) {
+        frame_release_retired(r_vk_renderer, p_window, &r_vk_renderer->frame_data[i]);
         vkDestroySemaphore(p_window->vk_device, r_vk_renderer->frame_data[i].image_available, NULL);
         vkDestroySemaphore(p_window->vk_device, r_vk_renderer->frame_data[i].render_finished, NULL);
         vkDestroyFence(p_window->vk_device, r_vk_renderer->frame_data[i].render_fence, NULL);
+        for (uint32_t j = 0; j < r_vk_renderer->record_count; j++) {
+            vkDestroyCommandPool(p_window->vk_device, r_vk_renderer->frame_data[i].record_pools[j], NULL);
+        }
+        mfree(r_vk_renderer->frame_data[i].record_pools);
+        mfree(r_vk_renderer->frame_data[i].record_command_buffers);
+
+        const VkSemaphoreVector *wait_semaphores = &r_vk_renderer->frame_data[i].wait_semaphores;
+        vk_semaphore_vector_append_range(&acquire->free_semaphores, wait_semaphores->data + 1, wait_semaphores->size - 1);
+        vk_semaphore_vector_free(&r_vk_renderer->frame_data[i].wait_semaphores);
+        memory_free_vkbuffer(&r_vk_renderer->gpu_allocator, p_window->vk_device, r_vk_renderer->frame_data[i].camera_buffer, &r_vk_renderer->frame_data[i].camera_memory);
+        if (r_vk_renderer->frame_data[i].instance_capacity > 0) {
+            memory_free_vkbuffer(&r_vk_renderer->gpu_allocator, p_window->vk_device, r_vk_renderer->frame_data[i].instance_buffer, &r_vk_renderer->frame_data[i].instance_memory);
+        }
+        if (r_vk_renderer->frame_data[i].cull_object_capacity > 0) {
+            memory_free_vkbuffer(&r_vk_renderer->gpu_allocator, p_window->vk_device, r_vk_renderer->frame_data[i].cull_object_buffer, &r_vk_renderer->frame_data[i].cull_object_memory);
+        }
+        if (r_vk_renderer->frame_data[i].draw_capacity > 0) {
+            memory_free_vkbuffer(&r_vk_renderer->gpu_allocator, p_window->vk_device, r_vk_renderer->frame_data[i].draw_buffer, &r_vk_renderer->frame_data[i].draw_memory);
+        }
+        if (r_vk_renderer->frame_data[i].meshlet_task_capacity > 0) {
+            memory_free_vkbuffer(&r_vk_renderer->gpu_allocator, p_window->vk_device, r_vk_renderer->frame_data[i].meshlet_task_buffer, &r_vk_renderer->frame_data[i].meshlet_task_memory);
+        }
+        if (r_vk_renderer->frame_data[i].meshlet_draw_capacity > 0) {
+            memory_free_vkbuffer(&r_vk_renderer->gpu_allocator, p_window->vk_device, r_vk_renderer->frame_data[i].meshlet_draw_buffer, &r_vk_renderer->frame_data[i].meshlet_draw_memory);
+        }
+        u32_vector_free(&r_vk_renderer->frame_data[i].wait_stages);
+        range_vector_free(&r_vk_renderer->frame_data[i].retired_vertices);
+        range_vector_free(&r_vk_renderer->frame_data[i].retired_indices);
+        range_vector_free(&r_vk_renderer->frame_data[i].retired_meshlets);
+        retired_texture_vector_free(&r_vk_renderer->frame_data[i].retired_textures);
     }
+    vk_semaphore_vector_append_range(&acquire->free_semaphores, acquire->semaphores.data, acquire->semaphores.size);
+    for (size_t i = 0; i < acquire->free_semaphores.size; i++) {
+        vkDestroySemaphore(p_window->vk_device, acquire->free_semaphores.data[i], NULL);
+    }
+    vk_semaphore_vector_free(&acquire->free_semaphores);
+    vk_semaphore_vector_free(&acquire->semaphores);
+    buffer_barrier_vector_free(&acquire->buffer_barriers);
+    image_barrier_vector_free(&acquire->image_barriers);
+
+    staging_temporary_vector_free(&r_vk_renderer->upload_batch.temporaries);
+    buffer_barrier_vector_free(&r_vk_renderer->upload_batch.buffer_barriers);
+    image_barrier_vector_free(&r_vk_renderer->upload_batch.image_barriers);
+    staging_ring_free(&r_vk_renderer->staging_ring, &r_vk_renderer->gpu_allocator, r_vk_renderer->transfer_command_pool);
+
     // Will automaticaly free any CommandBuffers in the pool
+    vkDestroyCommandPool(p_window->vk_device, r_vk_renderer->transfer_command_pool, NULL);
     vkDestroyCommandPool(p_window->vk_device, r_vk_renderer->command_pool, NULL);
 
     mfree(r_vk_renderer->frame_data);
+
+    vkDestroyImageView(p_window->vk_device, r_vk_renderer->depth_texture.image_view, NULL);
+    vkDestroyImage(p_window->vk_device, r_vk_renderer->depth_texture.image, NULL);
+    gpu_memory_free(&r_vk_renderer->gpu_allocator, &r_vk_renderer->depth_texture.memory);
+    geometry_buffer_free(r_vk_renderer, p_window, &r_vk_renderer->vertex_geometry);
+    geometry_buffer_free(r_vk_renderer, p_window, &r_vk_renderer->index_geometry);
+    geometry_buffer_free(r_vk_renderer, p_window, &r_vk_renderer->meshlet_geometry);
+    gpu_allocator_free(&r_vk_renderer->gpu_allocator);
+    hashmap_free(r_vk_renderer->texture_cache);
+    u32_vector_free(&r_vk_renderer->free_texture_indices);
 }
 
 /// Texture
 
-Texture *texture_create(const VkRenderer *p_vk_renderer, const Window *p_window, char *p_path) {
-    // TODO: Add cache
+Texture *texture_create(VkRenderer *p_vk_renderer, const Window *p_window, const char *p_path) {
+    char path[512];
+    get_canonical_path(path, p_path);
+    const size_t path_size = strlen(path) + 1;
+
+    Texture **cached = hashmap_get(p_vk_renderer->texture_cache, path, path_size);
+    if (cached) {
+        return texture_ref(*cached);
+    }
+
+    ArenaScope scratch = arena_scratch_begin();
+    image_arena = scratch.arena;
 
     int texture_width = 0;
     int texture_height = 0;
     int texture_channels = 0;
 
-    stbi_uc* pixels = stbi_load(p_path, &texture_width, &texture_height, &texture_channels, STBI_rgb_alpha);
-    CRASH_NULL_MSG(pixels, "FATAL: Failed to load texture '%s'!", p_path);
+    stbi_uc* pixels = stbi_load(path, &texture_width, &texture_height, &texture_channels, STBI_rgb_alpha);
+    CRASH_NULL_MSG(pixels, "FATAL: Failed to load texture '%s'!", path);
 
     // Create image
     VkImage vk_image;
@@ -792,8 +1779,8 @@ Texture *texture_create(const VkRenderer *p_vk_renderer, const Window *p_window,
     "%s", "FATAL: Failed to create image!");
 
     // Upload to the GPU
-    VkDeviceMemory buffer;
-    memory_upload_image(p_vk_renderer, p_window, vk_image, pixels, texture_width, texture_height, &buffer);
+    GpuAllocation memory;
+    memory_upload_image(p_vk_renderer, p_window, vk_image, pixels, texture_width, texture_height, &memory);
 
     // Crete image view
     VkImageView image_view;
@@ -811,105 +1798,198 @@ Texture *texture_create(const VkRenderer *p_vk_renderer, const Window *p_window,
     "%s", "FATAL: Failed to create image image view!");
 
     // Free memory
-    stbi_image_free(pixels);
+    arena_scratch_end(scratch);
+    image_arena = NULL;
+
+    // Slot in the texture array, freed slots first
+    uint32_t index;
+    if (p_vk_renderer->free_texture_indices.size > 0) {
+        index = p_vk_renderer->free_texture_indices.data[--p_vk_renderer->free_texture_indices.size];
+    } else {
+        CRASH_COND_MSG(p_vk_renderer->texture_count >= p_vk_renderer->texture_capacity, "FATAL: Texture array full, %u textures", p_vk_renderer->texture_capacity);
+        index = p_vk_renderer->texture_count++;
+    }
+
+    vkUpdateDescriptorSets(p_window->vk_device, 1, &(VkWriteDescriptorSet) {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = p_vk_renderer->texture_set,
+        .dstBinding = 0,
+        .dstArrayElement = index,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = 1,
+        .pImageInfo = &(VkDescriptorImageInfo) {
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .imageView = image_view,
+            .sampler = p_vk_renderer->image_sampler,
+        },
+        .pBufferInfo = NULL,
+        .pTexelBufferView = NULL,
+    }, 0, NULL);
 
     // Create and return
-    Texture *texture = mmalloc(sizeof(texture));
+    Texture *texture = pool_alloc(sizeof(Texture));
     texture->image = vk_image;
     texture->image_view = image_view;
-    texture->device_memory = buffer;
+    texture->memory = memory;
+    texture->index = index;
+    texture->path = pool_alloc(path_size);
+    memcpy(texture->path, path, path_size);
+    texture->ref_count = 1;
+    texture->sort_id = p_vk_renderer->next_sort_id++;
+
+    hashmap_insert(p_vk_renderer->texture_cache, path, path_size, &texture);
     return texture;
 }
 
-void texture_free(const Window *p_window, Texture *p_texture) {
-    vkDestroyImageView(p_window->vk_device, p_texture->image_view, NULL);
-    vkDestroyImage(p_window->vk_device, p_texture->image, NULL);
-    vkFreeMemory(p_window->vk_device, p_texture->device_memory, NULL);
-    mfree(p_texture);
+Texture *texture_ref(Texture *r_texture) {
+    r_texture->ref_count++;
+    return r_texture;
 }
 
-/// Surface
+void texture_unref(VkRenderer *p_vk_renderer, Texture *r_texture) {
+    ERR_FAIL_COND(r_texture->ref_count == 0);
+    if (--r_texture->ref_count > 0) {
+        return;
+    }
 
-void surface_descriptor_set_create(const VkRenderer *p_vk_renderer, const Window *p_window, VkImageView *texture, SurfaceDescriptorSet *r_surface_descriptor_set) {
-    CRASH_COND_MSG(vkAllocateDescriptorSets(p_window->vk_device, &(VkDescriptorSetAllocateInfo) {
-            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-            .descriptorPool = p_vk_renderer->descriptor_pool,
-            .descriptorSetCount = 1,
-            .pSetLayouts = &p_vk_renderer->descriptor_set,
-        }, &r_surface_descriptor_set->descriptor_set) != VK_SUCCESS,
-        "%s", "FATAL: Failed to allocate surface DescriptorSet!");
+    const size_t path_size = strlen(r_texture->path) + 1;
+    hashmap_remove(p_vk_renderer->texture_cache, r_texture->path, path_size);
+    pool_free(r_texture->path, path_size);
+
+    // Frames in flight may still sample it, the image and its slot go once the last submitted frame completes
+    FrameData *frame_data = &p_vk_renderer->frame_data[(p_vk_renderer->current_frame + p_vk_renderer->frames - 1) % p_vk_renderer->frames];
+    retired_texture_vector_push_back(&frame_data->retired_textures, (RetiredTexture){
+        .image = r_texture->image,
+        .image_view = r_texture->image_view,
+        .memory = r_texture->memory,
+        .index = r_texture->index,
+    });
+    pool_free(r_texture, sizeof(Texture));
+}
 
-    memory_create_vkbuffer(p_window->vk_device, p_window->vk_physical_device, sizeof(CameraBuffer), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &r_surface_descriptor_set->buffer, &r_surface_descriptor_set->memory);
+/// Mesh
+
+Mesh *mesh_create(VkRenderer *p_vk_renderer, const Window *p_window, const VertexVector *p_vertex_data, const U32Vector *p_index_data) {
+    Mesh *mesh = pool_alloc(sizeof(Mesh));
+    mesh->vertex_count = p_vertex_data->size;
+    mesh->bounds = aabb_from_points(p_vertex_data->size > 0 ? &p_vertex_data->data[0].pos : NULL, p_vertex_data->size, sizeof(Vertex));
+    mesh->ref_count = 1;
+    mesh->sort_id = p_vk_renderer->next_sort_id++;
+
+    // Each level is simplified from the one before so their errors add up. Kept levels have at most
+    // MESH_LOD_MIN_REDUCTION of the indices before them, and mesh_simplify first copies its whole
+    // input after the last kept level, so an attempt can write as many indices as the level before it.
+    size_t index_capacity = p_index_data->size;
+    size_t level_offset = 0;
+    size_t level_bound = p_index_data->size;
+    for (uint32_t i = 1; i < MESH_MAX_LODS; i++) {
+        level_offset += level_bound;
+        index_capacity = SDL_max(index_capacity, level_offset + level_bound);
+        level_bound = (size_t)(level_bound * MESH_LOD_MIN_REDUCTION);
+    }
 
-    CRASH_COND_MSG(vkMapMemory(p_window->vk_device, r_surface_descriptor_set->memory, 0, sizeof(CameraBuffer), 0, &r_surface_descriptor_set->camera_data) != VK_SUCCESS, "%s", "FATAL: Failed to map surface DescriptorSet buffer!");
+    ArenaScope scratch = arena_scratch_begin();
+    uint32_t *indices = arena_alloc(scratch.arena, sizeof(uint32_t) * index_capacity);
+    memcpy(indices, p_index_data->data, sizeof(uint32_t) * p_index_data->size);
+    mesh->lods[0] = (MeshLod){ .first_index = 0, .index_count = p_index_data->size, .error = 0.0f };
+    mesh->lod_count = 1;
+    mesh->index_count = p_index_data->size;
+
+    const Vect3 diagonal = vect3_sub(mesh->bounds.max, mesh->bounds.min);
+    const float max_error = sqrtf(vect3_dot(diagonal, diagonal)) * MESH_LOD_MAX_ERROR;
+    while (mesh->lod_count < MESH_MAX_LODS && p_vertex_data->size > 0) {
+        const MeshLod *previous = &mesh->lods[mesh->lod_count - 1];
+        float error;
+        const size_t index_count = mesh_simplify(indices + mesh->index_count, indices + previous->first_index, previous->index_count,
+            &p_vertex_data->data[0].pos, p_vertex_data->size, sizeof(Vertex), previous->index_count / 2, max_error, &error);
+        if (index_count == 0 || index_count > previous->index_count * MESH_LOD_MIN_REDUCTION) {
+            break;
+        }
 
-    // Inital update
-    vkUpdateDescriptorSets(p_window->vk_device, 2, (VkWriteDescriptorSet[]){
-        {
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = r_surface_descriptor_set->descriptor_set,
-            .dstBinding = 0,
-            .dstArrayElement = 0,
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .descriptorCount = 1,
-            .pBufferInfo = &(VkDescriptorBufferInfo) {
-                .buffer = r_surface_descriptor_set->buffer,
-                .offset = 0,
-                .range = sizeof(CameraBuffer),
-            },
-            .pImageInfo = NULL,
-            .pTexelBufferView = NULL,
-        },
-        {
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = r_surface_descriptor_set->descriptor_set,
-            .dstBinding = 1,
-            .dstArrayElement = 0,
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .descriptorCount = 1,
-            .pImageInfo = &(VkDescriptorImageInfo) {
-                .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                .imageView = *texture,
-                .sampler = p_vk_renderer->image_sampler,
-            },
-            .pBufferInfo = NULL,
-            .pTexelBufferView = NULL,
+        mesh->lods[mesh->lod_count++] = (MeshLod){ .first_index = mesh->index_count, .index_count = index_count, .error = previous->error + error };
+        mesh->index_count += index_count;
+    }
+
+    // Every level is reordered by meshlet, dense ones keep theirs
+    size_t meshlet_capacity = 0;
+    for (uint32_t i = 0; i < mesh->lod_count; i++) {
+        meshlet_capacity += meshlet_bound(mesh->lods[i].index_count);
+    }
+    Meshlet *meshlets = arena_alloc(scratch.arena, sizeof(Meshlet) * meshlet_capacity);
+    mesh->meshlet_count = 0;
+    for (uint32_t i = 0; i < mesh->lod_count && p_vertex_data->size > 0; i++) {
+        MeshLod *lod = &mesh->lods[i];
+        Meshlet *lod_meshlets = meshlets + mesh->meshlet_count;
+        const size_t meshlet_count = mesh_build_meshlets(lod_meshlets, indices + lod->first_index, indices + lod->first_index, lod->index_count,
+            &p_vertex_data->data[0].pos, p_vertex_data->size, sizeof(Vertex));
+        lod->first_meshlet = mesh->meshlet_count;
+        if (meshlet_count < MESH_MIN_MESHLETS) {
+            continue;
         }
-    }, 0, NULL);
-}
 
-Surface *surface_create(const VkRenderer *p_vk_renderer, const Window *p_window, Vector p_vertex, Vector p_index_data, Texture *p_texture) {
-    // TODO: Cache to re-use same memory
-    Surface *surface = mmalloc(sizeof(Surface));
+        for (size_t j = 0; j < meshlet_count; j++) {
+            lod_meshlets[j].first_index += lod->first_index;
+        }
+        lod->meshlet_count = meshlet_count;
+        mesh->meshlet_count += meshlet_count;
+    }
 
-    surface->vertex_data = (Vector){0, 0, sizeof(Vertex), NULL};
-    vector_copy(&p_vertex, &surface->vertex_data);
-    memory_upload_data(p_vk_renderer, p_window, surface->vertex_data.data, surface->vertex_data.data_size * surface->vertex_data.size, &surface->vertex_buffer, &surface->vertex_memory, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    uint32_t first_vertex;
+    CRASH_COND_MSG(!range_allocator_alloc(&p_vk_renderer->vertex_geometry.ranges, mesh->vertex_count, &first_vertex),
+        "FATAL: Vertex geometry buffer full, %u of %u vertices used", p_vk_renderer->vertex_geometry.ranges.used, p_vk_renderer->vertex_geometry.ranges.capacity);
+    CRASH_COND_MSG(!range_allocator_alloc(&p_vk_renderer->index_geometry.ranges, mesh->index_count, &mesh->first_index),
+        "FATAL: Index geometry buffer full, %u of %u indices used", p_vk_renderer->index_geometry.ranges.used, p_vk_renderer->index_geometry.ranges.capacity);
+    CRASH_COND_MSG(!range_allocator_alloc(&p_vk_renderer->meshlet_geometry.ranges, mesh->meshlet_count, &mesh->first_meshlet),
+        "FATAL: Meshlet geometry buffer full, %u of %u meshlets used", p_vk_renderer->meshlet_geometry.ranges.used, p_vk_renderer->meshlet_geometry.ranges.capacity);
+    mesh->vertex_offset = (int32_t)first_vertex;
+    for (uint32_t i = 0; i < mesh->lod_count; i++) {
+        mesh->lods[i].first_index += mesh->first_index;
+        mesh->lods[i].first_meshlet += mesh->first_meshlet;
+    }
+    for (uint32_t i = 0; i < mesh->meshlet_count; i++) {
+        meshlets[i].first_index += mesh->first_index;
+    }
 
-    surface->index_data = (Vector){0, 0, sizeof(uint32_t), NULL};
-    vector_copy(&p_index_data, &surface->index_data);
-    memory_upload_data(p_vk_renderer, p_window, surface->index_data.data, surface->index_data.data_size * surface->index_data.size, &surface->index_buffer, &surface->index_memory, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    vk_renderer_upload_begin(p_vk_renderer);
+    memory_upload_range(p_vk_renderer, p_window, p_vertex_data->data, sizeof(Vertex) * p_vertex_data->size, p_vk_renderer->vertex_geometry.buffer, sizeof(Vertex) * first_vertex);
+    memory_upload_range(p_vk_renderer, p_window, indices, sizeof(uint32_t) * mesh->index_count, p_vk_renderer->index_geometry.buffer, sizeof(uint32_t) * mesh->first_index);
+    memory_upload_range(p_vk_renderer, p_window, meshlets, sizeof(Meshlet) * mesh->meshlet_count, p_vk_renderer->meshlet_geometry.buffer, sizeof(Meshlet) * mesh->first_meshlet);
+    vk_renderer_upload_submit(p_vk_renderer, p_window);
+    arena_scratch_end(scratch);
+    return mesh;
+}
 
-    surface->texture = p_texture;
+Mesh *mesh_ref(Mesh *r_mesh) {
+    r_mesh->ref_count++;
+    return r_mesh;
+}
 
-    // Allocate DescriptorSets
-    surface->descriptor_sets = (Vector){0, 0, sizeof(SurfaceDescriptorSet), NULL};
-    vector_resize(&surface->descriptor_sets, p_vk_renderer->frames);
-    for (size_t i = 0; i < p_vk_renderer->frames; i++) {
-        surface_descriptor_set_create(p_vk_renderer, p_window, &surface->texture->image_view, vector_get(&surface->descriptor_sets, i));
+void mesh_unref(VkRenderer *p_vk_renderer, Mesh *r_mesh) {
+    ERR_FAIL_COND(r_mesh->ref_count == 0);
+    if (--r_mesh->ref_count > 0) {
+        return;
     }
-    return surface;
+
+    // Frames in flight may still draw it, the ranges are reused once the last submitted frame completes
+    FrameData *frame_data = &p_vk_renderer->frame_data[(p_vk_renderer->current_frame + p_vk_renderer->frames - 1) % p_vk_renderer->frames];
+    range_vector_push_back(&frame_data->retired_vertices, (Range){ (uint32_t)r_mesh->vertex_offset, r_mesh->vertex_count });
+    range_vector_push_back(&frame_data->retired_indices, (Range){ r_mesh->first_index, r_mesh->index_count });
+    range_vector_push_back(&frame_data->retired_meshlets, (Range){ r_mesh->first_meshlet, r_mesh->meshlet_count });
+    pool_free(r_mesh, sizeof(Mesh));
 }
 
-void surface_free(const Window *p_window, Surface *r_surface) {
-    vkDestroyBuffer(p_window->vk_device, r_surface->vertex_buffer, NULL);
-    vkFreeMemory(p_window->vk_device, r_surface->vertex_memory, NULL);
-    vkDestroyBuffer(p_window->vk_device,r_surface->index_buffer, NULL);
-    vkFreeMemory(p_window->vk_device, r_surface->index_memory, NULL);
+/// Surface
+
+void surface_init(Surface *r_surface, Mesh *p_mesh, Texture *p_texture) {
+    r_surface->mesh = mesh_ref(p_mesh);
+    r_surface->texture = texture_ref(p_texture);
+}
 
-    // TODO: Remove when texture cache exists
-    texture_free(p_window, r_surface->texture);
-    mfree(r_surface);
+void surface_release(VkRenderer *p_vk_renderer, Surface *r_surface) {
+    mesh_unref(p_vk_renderer, r_surface->mesh);
+    texture_unref(p_vk_renderer, r_surface->texture);
+    r_surface->mesh = NULL;
+    r_surface->texture = NULL;
 }
 
 
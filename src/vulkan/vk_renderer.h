@@ -3,44 +3,263 @@
 
 #include "src/camera.h"
 #include "src/data_structures/vector.h"
+#include "src/data_structures/slot_map.h"
+#include "src/data_structures/hash_map.h"
 #include "src/math/vectors.h"
 #include "src/math/matrices.h"
+#include "src/math/frustum.h"
+#include "src/math/meshlet.h"
 #include <SDL2/SDL.h>
 #include <vulkan/vulkan.h>
 #include <SDL2/SDL_vulkan.h>
 #include "vk_window.h"
+#include "vk_memory.h"
 
 typedef struct CameraBuffer {
-    Mat4 model;
     Mat4 view;
     Mat4 proj;
 } CameraBuffer;
 
+// Per instance vertex input, the model matrix is read as four vec4 columns from location 4
+// and the normal matrix, computed once per object on the CPU, as three from location 8.
+// The texture slot from location 11 indexes the bindless texture array, see Texture.
+typedef struct InstanceData {
+    Mat4 model;
+    Mat3x4 normal;
+    uint32_t texture;
+    uint32_t padding[3]; // std430 size of the struct in shaders/cull_shader.comp
+} InstanceData;
+
+// Input of shaders/cull_shader.comp, std430 layout. Visible objects are copied into the
+// instance buffer slice of their draw, whose instanceCount the shader increments. Objects
+// with meshlets keep their own instance slot and are handed to the meshlet pass instead.
+typedef struct CullObject {
+    InstanceData instance;
+    Vect4 sphere; // World space center and radius
+    uint32_t draw;
+    uint32_t first_meshlet;
+    uint32_t meshlet_count; // 0 to draw the whole level
+    uint32_t padding;
+} CullObject;
+
+// Shared by both culling shaders.
+typedef struct CullPushConstants {
+    Vect4 planes[6];
+    Vect4 eye; // World space camera position, for the meshlet cones
+    uint32_t object_count;
+} CullPushConstants;
+
+#define CULL_GROUP_SIZE 64
+#define CULL_BINDING_COUNT 6 // Storage buffers of the cull set, see frame_cull_reserve
+
+// Start of the meshlet task buffer, the indices of the visible objects drawn per meshlet follow.
+// shaders/cull_shader.comp appends them and counts them in dispatch.x, one meshlet workgroup each.
+// shaders/meshlet_cull_shader.comp compacts the draws of visible meshlets and counts them in draw_count.
+typedef struct MeshletTasks {
+    VkDispatchIndirectCommand dispatch;
+    uint32_t draw_count;
+} MeshletTasks;
+
+#define MESHLET_GROUP_SIZE 64
+
+// Every sampled texture has a slot in one partially bound array, set 1, bound once per command buffer.
+// Slots of freed textures are reused once the frames that could sample them completed.
+#define TEXTURE_MAX_COUNT 4096 // Clamped to the update after bind limits of the device
+#define TEXTURE_NO_INDEX UINT32_MAX
+
 typedef struct Texture {
     VkImage image;
     VkImageView image_view;
-    VkDeviceMemory device_memory;
+    GpuAllocation memory;
+    uint32_t index; // Slot in the texture array, TEXTURE_NO_INDEX for render targets
+
+    // Cache key and references, NULL path for render targets the cache does not own.
+    char *path;
+    uint32_t ref_count;
+    uint32_t sort_id; // Draw key bits, see draw_key
 } Texture;
 
+// What a freed texture leaves to destroy once the frames that could sample it completed.
+typedef struct RetiredTexture {
+    VkImage image;
+    VkImageView image_view;
+    GpuAllocation memory;
+    uint32_t index;
+} RetiredTexture;
+
+VECTOR_DEFINE(RetiredTextureVector, retired_texture_vector, RetiredTexture)
+#define retired_texture_vector_reserve(...) retired_texture_vector_reserve(VECTOR_SITE(__VA_ARGS__))
+#define retired_texture_vector_push_back(...) retired_texture_vector_push_back(VECTOR_SITE(__VA_ARGS__))
+#define retired_texture_vector_extend_uninitialized(...) retired_texture_vector_extend_uninitialized(VECTOR_SITE(__VA_ARGS__))
+#define retired_texture_vector_append_range(...) retired_texture_vector_append_range(VECTOR_SITE(__VA_ARGS__))
+#define retired_texture_vector_clone(...) retired_texture_vector_clone(VECTOR_SITE(__VA_ARGS__))
+
 /// FrameData
 
 typedef struct FragPushConstants {
     uint32_t lighting_enabled;
 } FragPushConstants;
 
+VECTOR_DEFINE(VkSemaphoreVector, vk_semaphore_vector, VkSemaphore)
+#define vk_semaphore_vector_reserve(...) vk_semaphore_vector_reserve(VECTOR_SITE(__VA_ARGS__))
+#define vk_semaphore_vector_push_back(...) vk_semaphore_vector_push_back(VECTOR_SITE(__VA_ARGS__))
+#define vk_semaphore_vector_extend_uninitialized(...) vk_semaphore_vector_extend_uninitialized(VECTOR_SITE(__VA_ARGS__))
+#define vk_semaphore_vector_append_range(...) vk_semaphore_vector_append_range(VECTOR_SITE(__VA_ARGS__))
+#define vk_semaphore_vector_clone(...) vk_semaphore_vector_clone(VECTOR_SITE(__VA_ARGS__))
+
 typedef struct FrameData {
     VkSemaphore image_available;
     VkSemaphore render_finished;
     VkFence render_fence;
     VkCommandBuffer command_buffer;
+
+    // Secondary command buffer per chunk, each from its own pool, record_count of them.
+    VkCommandPool *record_pools;
+    VkCommandBuffer *record_command_buffers;
+
+    // image_available first, then upload semaphores recycled once render_fence signals.
+    VkSemaphoreVector wait_semaphores;
+    U32Vector wait_stages;
+
+    // Set 0, view and projection written once per frame
+    VkBuffer camera_buffer;
+    GpuAllocation camera_memory;
+    VkDescriptorSet camera_descriptor_set;
+
+    // Every object drawn this frame, grouped by mesh. Grows, never shrinks.
+    VkBuffer instance_buffer;
+    GpuAllocation instance_memory;
+    size_t instance_capacity;
+
+    // GPU culling input and the indirect draws it fills, one per mesh run.
+    VkBuffer cull_object_buffer;
+    GpuAllocation cull_object_memory;
+    size_t cull_object_capacity;
+    VkBuffer draw_buffer;
+    GpuAllocation draw_memory;
+    size_t draw_capacity;
+    VkDescriptorSet cull_descriptor_set;
+    bool cull_set_dirty;
+
+    // Visible objects drawn per meshlet, then the draws of their visible meshlets.
+    VkBuffer meshlet_task_buffer;
+    GpuAllocation meshlet_task_memory;
+    size_t meshlet_task_capacity; // In uint32_t, the MeshletTasks head included
+    VkBuffer meshlet_draw_buffer;
+    GpuAllocation meshlet_draw_memory;
+    size_t meshlet_draw_capacity;
+
+    // Geometry ranges of meshes freed after this frame was submitted, released once it completes.
+    RangeVector retired_vertices;
+    RangeVector retired_indices;
+    RangeVector retired_meshlets;
+
+    // Textures freed after this frame was submitted, destroyed and their slots reused once it completes.
+    RetiredTextureVector retired_textures;
 } FrameData;
 
+/// Uploads
+
+VECTOR_DEFINE(BufferBarrierVector, buffer_barrier_vector, VkBufferMemoryBarrier)
+#define buffer_barrier_vector_reserve(...) buffer_barrier_vector_reserve(VECTOR_SITE(__VA_ARGS__))
+#define buffer_barrier_vector_push_back(...) buffer_barrier_vector_push_back(VECTOR_SITE(__VA_ARGS__))
+#define buffer_barrier_vector_extend_uninitialized(...) buffer_barrier_vector_extend_uninitialized(VECTOR_SITE(__VA_ARGS__))
+#define buffer_barrier_vector_append_range(...) buffer_barrier_vector_append_range(VECTOR_SITE(__VA_ARGS__))
+#define buffer_barrier_vector_clone(...) buffer_barrier_vector_clone(VECTOR_SITE(__VA_ARGS__))
+VECTOR_DEFINE(ImageBarrierVector, image_barrier_vector, VkImageMemoryBarrier)
+#define image_barrier_vector_reserve(...) image_barrier_vector_reserve(VECTOR_SITE(__VA_ARGS__))
+#define image_barrier_vector_push_back(...) image_barrier_vector_push_back(VECTOR_SITE(__VA_ARGS__))
+#define image_barrier_vector_extend_uninitialized(...) image_barrier_vector_extend_uninitialized(VECTOR_SITE(__VA_ARGS__))
+#define image_barrier_vector_append_range(...) image_barrier_vector_append_range(VECTOR_SITE(__VA_ARGS__))
+#define image_barrier_vector_clone(...) image_barrier_vector_clone(VECTOR_SITE(__VA_ARGS__))
+
+typedef struct StagingTemporary {
+    VkBuffer buffer;
+    GpuAllocation memory;
+} StagingTemporary;
+
+VECTOR_DEFINE(StagingTemporaryVector, staging_temporary_vector, StagingTemporary)
+#define staging_temporary_vector_reserve(...) staging_temporary_vector_reserve(VECTOR_SITE(__VA_ARGS__))
+#define staging_temporary_vector_push_back(...) staging_temporary_vector_push_back(VECTOR_SITE(__VA_ARGS__))
+#define staging_temporary_vector_extend_uninitialized(...) staging_temporary_vector_extend_uninitialized(VECTOR_SITE(__VA_ARGS__))
+#define staging_temporary_vector_append_range(...) staging_temporary_vector_append_range(VECTOR_SITE(__VA_ARGS__))
+#define staging_temporary_vector_clone(...) staging_temporary_vector_clone(VECTOR_SITE(__VA_ARGS__))
+
+typedef struct UploadBatch {
+    StagingSubmit *submit;
+    uint32_t depth;
+    StagingTemporaryVector temporaries; // Oversized staging, freed once the batch completes
+
+    // Queue family ownership of everything written, released by the transfer queue on flush.
+    BufferBarrierVector buffer_barriers;
+    ImageBarrierVector image_barriers;
+} UploadBatch;
+
+// Released ownership waiting to be acquired by the next frame, after the upload semaphores.
+typedef struct UploadAcquire {
+    BufferBarrierVector buffer_barriers;
+    ImageBarrierVector image_barriers;
+    VkSemaphoreVector semaphores;
+    VkSemaphoreVector free_semaphores;
+} UploadAcquire;
+
+/// Geometry
+
+// Capacities in vertices, indices and meshlets. Every mesh is a range of each buffer.
+#define GEOMETRY_VERTEX_CAPACITY (1024 * 1024)
+#define GEOMETRY_INDEX_CAPACITY (4 * 1024 * 1024)
+#define GEOMETRY_MESHLET_CAPACITY (128 * 1024)
+
+// Device local and shared between the graphics and transfer families, so ranges are
+// written without an ownership transfer of the whole buffer.
+typedef struct GeometryBuffer {
+    VkBuffer buffer;
+    GpuAllocation memory;
+    RangeAllocator ranges;
+} GeometryBuffer;
+
+/// Recording
+
+// The draw list is split into chunks of runs, each recorded into a secondary command buffer
+// by whichever job thread picks it up, the primary executes them in order.
+#define RECORD_MIN_RUNS_PER_CHUNK 64
+
+// Per object work of a frame is split into jobs of at least this many objects.
+#define DRAW_MIN_OBJECTS_PER_JOB 1024
+
+// Counts of the last recorded frame. Instances are before GPU culling when it is on.
+typedef struct DrawStats {
+    uint32_t objects;
+    uint32_t instances;
+    uint32_t runs;
+    uint32_t draw_calls;
+    uint32_t pipeline_binds;
+    uint32_t descriptor_set_binds;
+    uint32_t vertex_buffer_binds;
+    uint32_t index_buffer_binds;
+    uint32_t triangles; // Of the selected levels of detail
+    uint32_t meshlets; // Sent to the meshlet pass, before culling
+} DrawStats;
+
 typedef struct VkRenderer {
+    GpuAllocator gpu_allocator;
+
     size_t frames;
     size_t current_frame;
     FrameData *frame_data;
     VkCommandPool command_pool;
 
+    // Uploads are copied through here on the transfer queue, retired by fence.
+    VkCommandPool transfer_command_pool;
+    StagingRing staging_ring;
+    UploadBatch upload_batch;
+    UploadAcquire upload_acquire;
+
+    // Bound once per frame, draws select a mesh with firstIndex and vertexOffset.
+    GeometryBuffer vertex_geometry;
+    GeometryBuffer index_geometry;
+    GeometryBuffer meshlet_geometry; // Read by the meshlet pass only
+
     // One fixed pipeline for now.
     VkPipeline pipeline;
     VkPipelineLayout pipeline_layout;
@@ -48,10 +267,40 @@ typedef struct VkRenderer {
     VkShaderModule vert_shader_module;
     VkShaderModule frag_shader_module;
 
-    // One descriptor pool with large .maxSets
-    VkDescriptorSetLayout descriptor_set;
+    // Frustum culling in a compute pass feeding indirect draws, CPU culling when off.
+    // Coarser levels of detail for objects whose error stays under a pixel, see MeshLod.
+    bool lod_enabled;
+
+    // Needs drawIndirectFirstInstance, gpu_culling_supported is false without it.
+    bool gpu_culling;
+    bool gpu_culling_supported;
+    VkPipeline cull_pipeline;
+    VkPipelineLayout cull_pipeline_layout;
+    VkShaderModule cull_shader_module;
+    VkDescriptorSetLayout cull_set_layout;
+    uint32_t max_draw_indirect_count; // 1 without multiDrawIndirect
+
+    // Dense levels of visible objects culled again per meshlet, by frustum and normal cone, see Meshlet.
+    // Needs drawIndirectCount and multiDrawIndirect on top of GPU culling, levels are drawn whole without
+    // and in frames with more meshlets than maxDrawIndirectCount.
+    bool meshlet_culling;
+    bool meshlet_culling_supported;
+    VkPipeline meshlet_cull_pipeline;
+    VkShaderModule meshlet_cull_shader_module;
+
+    // Sets by update frequency: 0 per frame camera, 1 every texture. Per object data, the
+    // texture slot included, is in the instance buffer.
+    VkDescriptorSetLayout frame_set_layout;
     VkDescriptorPool descriptor_pool;
 
+    // Written as textures are created, the pool and layout are update after bind.
+    VkDescriptorSetLayout texture_set_layout;
+    VkDescriptorPool texture_descriptor_pool;
+    VkDescriptorSet texture_set;
+    uint32_t texture_capacity;
+    uint32_t texture_count; // Slots handed out at least once
+    U32Vector free_texture_indices;
+
     // FrameBuffers
     Texture depth_texture;
     VkFramebuffer *vk_frame_buffers;
@@ -61,23 +310,46 @@ typedef struct VkRenderer {
     VkViewport vk_viewport;
     VkRect2D vk_scissor;
 
+    // Canonical path to Texture *, every file is decoded and uploaded once.
+    HashMap *texture_cache;
+
+    // Most chunks recorded per frame, one per job thread.
+    uint32_t record_count;
+
+    // Handed to textures and meshes for draw sort keys.
+    uint32_t next_sort_id;
+    DrawStats draw_stats;
+
     // Push constants
     FragPushConstants frag_push_constants;
 } VkRenderer;
 
 void vk_renderer_create(VkRenderer *r_vk_renderer, const Window *p_window, size_t p_frame_count);
 
-void vk_draw_frame(VkRenderer *p_vk_renderer, const Window *p_window, Camera *camera, const Vector *objects);
+// Objects sharing a mesh and texture are drawn with one instanced draw, r_frame_arena holds the sort.
+// Draws are ordered by a radix sorted key of pipeline, texture, mesh and depth, binds that match
+// the previous draw are skipped. Each texture's meshes go out as one multi draw when culled on the GPU.
+void vk_draw_frame(VkRenderer *p_vk_renderer, const Window *p_window, Camera *camera, const SlotMap *objects, Arena *r_frame_arena);
 
 void vk_renderer_free(VkRenderer *r_vk_renderer, const Window *p_window);
 
+// Uploads between begin and submit are recorded into one command buffer and submitted with one fence.
+// Batches nest and only the outermost submit flushes, uploads outside a batch submit on their own.
+void vk_renderer_upload_begin(VkRenderer *r_vk_renderer);
+
+void vk_renderer_upload_submit(VkRenderer *r_vk_renderer, const Window *p_window);
+
 /// Texture
 
-Texture *texture_create(const VkRenderer *p_vk_renderer, const Window *p_window, char *p_path);
+// Returns the cached texture for p_path with a new reference, loading it on first use.
+Texture *texture_create(VkRenderer *p_vk_renderer, const Window *p_window, const char *p_path);
 
-void texture_free(const Window *p_window, Texture *p_texture);
+Texture *texture_ref(Texture *r_texture);
 
-/// Surface
+// The last reference removes it from the cache, its image is destroyed once frames sampling it complete.
+void texture_unref(VkRenderer *p_vk_renderer, Texture *r_texture);
+
+/// Mesh
 
 typedef struct vertex {
     Vect3 pos;
@@ -86,32 +358,72 @@ typedef struct vertex {
     Vect2 tex_coord;
 } Vertex;
 
-// Could use offset rather the buffer per surface
-typedef struct SurfaceDescriptorSet {
-    VkBuffer buffer;
-    VkDeviceMemory memory;
-    void *camera_data;
-    VkDescriptorSet descriptor_set;
-} SurfaceDescriptorSet;
+VECTOR_DEFINE(VertexVector, vertex_vector, Vertex)
+#define vertex_vector_reserve(...) vertex_vector_reserve(VECTOR_SITE(__VA_ARGS__))
+#define vertex_vector_push_back(...) vertex_vector_push_back(VECTOR_SITE(__VA_ARGS__))
+#define vertex_vector_extend_uninitialized(...) vertex_vector_extend_uninitialized(VECTOR_SITE(__VA_ARGS__))
+#define vertex_vector_append_range(...) vertex_vector_append_range(VECTOR_SITE(__VA_ARGS__))
+#define vertex_vector_clone(...) vertex_vector_clone(VECTOR_SITE(__VA_ARGS__))
 
-void surface_descriptor_set_create(const VkRenderer *p_vk_renderer, const Window *p_window, VkImageView *texture, SurfaceDescriptorSet *r_surface_descriptor_set);
+// Levels of detail are simplified from the previous one at load, each with about half the triangles.
+// They reuse the mesh's vertices, only their index lists follow each other in the index range.
+#define MESH_MAX_LODS 6 // At most 8, see draw_key
+#define MESH_LOD_MIN_REDUCTION 0.85f // Stop once a level keeps more of the previous one's indices
+#define MESH_LOD_MAX_ERROR 0.05f // Per level, relative to the diagonal of the bounds
+#define MESH_LOD_MAX_SCREEN_ERROR 1.0f // Pixels
 
-typedef struct Surface {
-    Vector vertex_data;
-    VkBuffer vertex_buffer;
-    VkDeviceMemory vertex_memory;
+// Every level's triangles are ordered by meshlet at load. Levels with fewer meshlets than this are
+// cheaper to draw whole and instanced, they keep none.
+#define MESH_MIN_MESHLETS 8
 
-    Vector index_data;
-    VkBuffer index_buffer;
-    VkDeviceMemory index_memory;
+typedef struct MeshLod {
+    uint32_t first_index;
+    uint32_t index_count;
+    float error; // Upper bound of the distance to the full mesh surface, in mesh units
+    uint32_t first_meshlet;
+    uint32_t meshlet_count;
+} MeshLod;
 
-    Texture *texture;
+// Geometry uploaded once and shared by every surface drawing it, freed with the last reference.
+// Offsets are in vertices and indices into the renderer's geometry buffers.
+typedef struct Mesh {
+    int32_t vertex_offset;
+    uint32_t vertex_count;
+
+    // Index range of every level, lods[0] is the full mesh
+    uint32_t first_index;
+    uint32_t index_count;
+    MeshLod lods[MESH_MAX_LODS];
+    uint32_t lod_count;
+
+    // Meshlet range of every level
+    uint32_t first_meshlet;
+    uint32_t meshlet_count;
 
-    Vector descriptor_sets; // One per frame
+    Aabb bounds; // Local space, for culling
+    uint32_t ref_count;
+    uint32_t sort_id; // Draw key bits, see draw_key
+} Mesh;
+
+// Starts with one reference. The vectors are only read, callers may free them once this returns.
+Mesh *mesh_create(VkRenderer *p_vk_renderer, const Window *p_window, const VertexVector *p_vertex_data, const U32Vector *p_index_data);
+
+Mesh *mesh_ref(Mesh *r_mesh);
+
+// The last reference frees it, its geometry ranges are reused once frames drawing it complete.
+void mesh_unref(VkRenderer *p_vk_renderer, Mesh *r_mesh);
+
+/// Surface
+
+typedef struct Surface {
+    Mesh *mesh;
+    Texture *texture;
 } Surface;
 
-Surface *surface_create(const VkRenderer *p_vk_renderer, const Window *p_window, Vector p_vertex, Vector p_index_data, Texture *p_texture);
+// Surfaces are held by value, e.g. inside an Object. Takes a reference to p_mesh and p_texture.
+void surface_init(Surface *r_surface, Mesh *p_mesh, Texture *p_texture);
 
-void surface_free(const Window *p_window, Surface *r_surface);
+// Drops the references taken by surface_init.
+void surface_release(VkRenderer *p_vk_renderer, Surface *r_surface);
 
 #endif
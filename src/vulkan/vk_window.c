@@ -35,7 +35,7 @@ void vk_window_create(Window *r_window, const char *p_title, size_t p_width, siz
                 .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
                 .pEngineName = "vk_renderer",
                 .engineVersion = VK_MAKE_API_VERSION(1, 1, 0, 0),
-                .apiVersion = VK_API_VERSION_1_0,
+                .apiVersion = VK_API_VERSION_1_2,
             },
             .enabledExtensionCount = extension_count,
             .ppEnabledExtensionNames = extension_names,
@@ -77,7 +77,20 @@ void vk_window_create(Window *r_window, const char *p_title, size_t p_width, siz
         if (!device_features.samplerAnisotropy) {
             continue;
         }
-        r_window->max_sampler_anisotropy = device_properties.limits.maxSamplerAnisotropy;
+
+        // Check for descriptor indexing, every texture is in one array indexed per instance
+        if (device_properties.apiVersion < VK_API_VERSION_1_2) {
+            continue;
+        }
+        VkPhysicalDeviceVulkan12Features vulkan12_features = { .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+        vkGetPhysicalDeviceFeatures2(physical_devices[i], &(VkPhysicalDeviceFeatures2) {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = &vulkan12_features,
+        });
+        if (!vulkan12_features.runtimeDescriptorArray || !vulkan12_features.descriptorBindingPartiallyBound ||
+            !vulkan12_features.descriptorBindingSampledImageUpdateAfterBind || !vulkan12_features.shaderSampledImageArrayNonUniformIndexing) {
+            continue;
+        }
 
         // Bonus points for dedicated GPU
         score += device_properties.limits.maxImageDimension2D;
@@ -97,7 +110,7 @@ void vk_window_create(Window *r_window, const char *p_title, size_t p_width, siz
 
         bool found = false;
         for (uint32_t j = 0; j < queue_family_count; j++) {
-            if (queue_families[j].queueFlags > 0 && queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            if (queue_families[j].queueFlags > 0 && queue_families[j].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
                 r_window->vk_queue_index = j;
                 found = true;
                 break;
@@ -224,9 +237,12 @@ void vk_window_create(Window *r_window, const char *p_title, size_t p_width, siz
             continue;
         }
 
+        // Limits and optional features of the chosen device only, they are enabled on it later
         if (score > device_score) {
             device_idx = i;
             device_score = score;
+            r_window->max_sampler_anisotropy = device_properties.limits.maxSamplerAnisotropy;
+            r_window->draw_indirect_count = vulkan12_features.drawIndirectCount;
         }
     }
     CRASH_COND_MSG(device_score == 0, "%s", "FATAL: Failed to find suitable device!");
@@ -234,28 +250,65 @@ void vk_window_create(Window *r_window, const char *p_title, size_t p_width, siz
 
     mfree(physical_devices);
 
+    // Look for a transfer only queue family, those map to the copy engines and run beside graphics.
+    // Falls back to the graphics queue, VK_RENDERER_NO_TRANSFER_QUEUE forces the fallback.
+    r_window->vk_transfer_queue_index = r_window->vk_queue_index;
+    if (SDL_getenv("VK_RENDERER_NO_TRANSFER_QUEUE") == NULL) {
+        uint32_t queue_family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(r_window->vk_physical_device, &queue_family_count, NULL);
+        VkQueueFamilyProperties *queue_families = mmalloc(sizeof(VkQueueFamilyProperties) * queue_family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(r_window->vk_physical_device, &queue_family_count, queue_families);
+
+        for (uint32_t i = 0; i < queue_family_count; i++) {
+            if (queue_families[i].queueCount > 0 && queue_families[i].queueFlags & VK_QUEUE_TRANSFER_BIT &&
+                !(queue_families[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+                r_window->vk_transfer_queue_index = i;
+                break;
+            }
+        }
+        mfree(queue_families);
+    }
+
     // Create virtual device
     // TODO: Move to renderer?
     const float queue_priority = 1.0f;
     const char *device_enabled_extension_names = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+    const VkDeviceQueueCreateInfo queue_create_infos[] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+            .queueFamilyIndex = r_window->vk_queue_index,
+            .queueCount = 1,
+            .pQueuePriorities = &queue_priority,
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+            .queueFamilyIndex = r_window->vk_transfer_queue_index,
+            .queueCount = 1,
+            .pQueuePriorities = &queue_priority,
+        },
+    };
     CRASH_COND_MSG(vkCreateDevice(r_window->vk_physical_device,
         &(VkDeviceCreateInfo){
             .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-            .queueCreateInfoCount = 1,
-            .pQueueCreateInfos = &(VkDeviceQueueCreateInfo) {
-                .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-                .queueFamilyIndex = r_window->vk_queue_index,
-                .queueCount = 1,
-                .pQueuePriorities = &queue_priority,
+            .pNext = &(VkPhysicalDeviceVulkan12Features) {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+                .runtimeDescriptorArray = VK_TRUE,
+                .descriptorBindingPartiallyBound = VK_TRUE,
+                .descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+                .shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
+                .drawIndirectCount = r_window->draw_indirect_count,
             },
+            .queueCreateInfoCount = r_window->vk_transfer_queue_index != r_window->vk_queue_index ? 2 : 1,
+            .pQueueCreateInfos = queue_create_infos,
             .enabledExtensionCount = 1,
             .ppEnabledExtensionNames = &device_enabled_extension_names,
             .pEnabledFeatures = &device_features,
         }, NULL, &r_window->vk_device) != VK_SUCCESS,
         "%s", "FATAL: Failed to create device!");
 
-    // Get queue
+    // Get queues, both are the same handle on the fallback path
     vkGetDeviceQueue(r_window->vk_device, r_window->vk_queue_index, 0, &r_window->vk_queue);
+    vkGetDeviceQueue(r_window->vk_device, r_window->vk_transfer_queue_index, 0, &r_window->vk_transfer_queue);
 
     // Create surface swapchain
     CRASH_COND_MSG(vkCreateSwapchainKHR(r_window->vk_device,
@@ -1,6 +1,7 @@
 #ifndef VK_WINDOW_H_
 #define VK_WINDOW_H_
 
+#include <stdbool.h>
 #include <SDL2/SDL.h>
 #include <vulkan/vulkan.h>
 #include <SDL2/SDL_vulkan.h>
@@ -19,6 +20,7 @@ typedef struct Window {
     VkPhysicalDevice vk_physical_device;
     uint32_t image_count;
     float max_sampler_anisotropy;
+    bool draw_indirect_count; // Optional in Vulkan 1.2, enabled when supported
     VkSurfaceFormatKHR vk_surface_format;
     VkExtent2D vk_extent2D;
     VkFormat vk_depth_format;
@@ -26,6 +28,8 @@ typedef struct Window {
     VkDevice vk_device;
     VkQueue vk_queue;
     uint32_t vk_queue_index;
+    VkQueue vk_transfer_queue;
+    uint32_t vk_transfer_queue_index;
     VkSwapchainKHR vk_swapchain;
 
     WindowImage *images;